@@ -3,6 +3,13 @@
 #include <chrono>
 #endif
 #include "datetime_parser.h"
+#include "datetime_calendar.h"
+#include "datetime_instrumentation.h"
+#include "datetime_iso8601.h"
+#include "datetime_utils.h"
+#ifdef DATETIME_DECODE_TABLE
+#include "datetime_decode_table.h"
+#endif
 namespace gtr {
 constexpr inline bool is_leap_year(int year) { return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0; }
 constexpr unsigned int monthdays[13] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365}; // Non-leap year
@@ -17,7 +24,8 @@ static inline constexpr unsigned int leap_years_count(int start_year, int end_ye
     return ((end_year / 4) - (end_year / 100) + (end_year / 400)) - ((start_year / 4) - (start_year / 100) + (start_year / 400));
 }
 
-static inline constexpr void epoch_to_datetime_pack(long long time, datetime_struct &pack) {
+static inline DATETIME_INSTRUMENTED_CONSTEXPR void epoch_to_datetime_pack(long long time, datetime_struct &pack) {
+    DATETIME_INSTRUMENT_CALL(epoch_to_datetime_pack);
     // Set microseconds
     if (time > 0)
         pack.microsecond = time % 1000000LL;
@@ -55,8 +63,9 @@ static inline constexpr void epoch_to_datetime_pack(long long time, datetime_str
     pack.second = (sec_per_day % (60 * 60)) % 60;
 }
 
-static inline constexpr long long seconds_since_epoch(const int day, const int month, const int year, const int hour, const int minute,
-                                                      const int second) {
+static inline DATETIME_INSTRUMENTED_CONSTEXPR long long seconds_since_epoch(const int day, const int month, const int year, const int hour,
+                                                                            const int minute, const int second) {
+    DATETIME_INSTRUMENT_CALL(seconds_since_epoch);
 
     // Reference https://pubs.opengroup.org/onlinepubs/9699919799/basedefs/V1_chap04.html#tag_04
     int day_corrected = days_until_month(year, month > 0 && month <= 12 ? month : 12) + day - 1;
@@ -77,6 +86,13 @@ static inline constexpr long long seconds_since_epoch(const int day, const int m
     return (second + minute * 60 + hour * 3600 - total_days * 86400LL);
 }
 
+// Returns 4 for a full name token (MMMM, dddd), 3 for an abbreviation (MMM, ddd), otherwise the token is shorter
+static inline int is_name_token(const char *state, char letter) {
+    if (state[1] != letter || state[2] != letter)
+        return 0;
+    return state[3] == letter ? 4 : 3;
+}
+
 /**
  * Converts a datetime to a string based on the specified format.
  *
@@ -86,6 +102,9 @@ static inline constexpr long long seconds_since_epoch(const int day, const int m
  * - YY: Two-digit year (e.g., 24)
  * - MM: Two-digit month (01 to 12)
  * - MMM: Three-letter abbreviation of the month (e.g., Jan, Feb)
+ * - MMMM: Full month name (e.g., January)
+ * - ddd: Three-letter abbreviation of the weekday (e.g., Mon)
+ * - dddd: Full weekday name (e.g., Monday)
  * - DD: Two-digit day (01 to 31)
  * - hh: Two-digit hour (00 to 23)
  * - mm: Two-digit minute (00 to 59)
@@ -100,8 +119,9 @@ static inline constexpr long long seconds_since_epoch(const int day, const int m
  * - "hh:mm:ss.uuuuuu" -> "14:35:45.123456"
  *
  */
-static bool datetime_to_string(datetime date, char *out, const char *format = DATETIME_DEFAULT_FORMAT,
-                               date_format group_format = date_format::text_date) {
+static int datetime_to_string(datetime date, char *out, const char *format = DATETIME_DEFAULT_FORMAT,
+                              date_format group_format = date_format::text_date) {
+    DATETIME_INSTRUMENT_CALL(datetime_to_string);
     if (group_format == date_format::text_date) {
         datetime_struct pack;
         date.to_pack(pack);
@@ -113,11 +133,21 @@ static bool datetime_to_string(datetime date, char *out, const char *format = DA
                 day_field::puts(&state, &out_ptr, pack);
                 break;
             case 'M':
-                if (*(state + 1) == 'M' && *(state + 2) == 'M')
+                if (is_name_token(state, 'M') == 4)
+                    month_field<month_format::month_name>::puts(&state, &out_ptr, pack);
+                else if (is_name_token(state, 'M') == 3)
                     month_field<month_format::month_abbrev>::puts(&state, &out_ptr, pack);
                 else
                     month_field<>::puts(&state, &out_ptr, pack);
                 break;
+            case 'd':
+                if (is_name_token(state, 'd') == 4)
+                    weekday_field<weekday_format::weekday_name>::puts(&state, &out_ptr, pack);
+                else if (is_name_token(state, 'd') == 3)
+                    weekday_field<>::puts(&state, &out_ptr, pack);
+                else
+                    separator_field<>::puts(&state, &out_ptr, pack);
+                break;
             case 'Y':
                 year_field<>::puts(&state, &out_ptr, pack);
                 break;
@@ -139,12 +169,15 @@ static bool datetime_to_string(datetime date, char *out, const char *format = DA
             }
         }
         end_string(out_ptr);
-        return true;
+        return static_cast<int>(out_ptr - out);
     }
-    return datetime_to_string(date, out, "YYYY-MM-DDThh:mm:ss+00:00", date_format::text_date);
+    iso8601_format iso;
+    iso.utc_as_z = false;
+    return format_iso8601(date, out, iso);
 }
 
 static long long parse_datetime_string(const char *date, const char *format, date_format group_format = date_format::text_date) {
+    DATETIME_INSTRUMENT_CALL(parse_datetime_string);
     const char *state = format;
     const char *date_char = date;
     datetime_struct pack{};
@@ -152,11 +185,21 @@ static long long parse_datetime_string(const char *date, const char *format, dat
         while (*state != '\0') {
             switch (*state) {
             case 'M':
-                if (*(state + 1) == 'M' && *(state + 2) == 'M')
+                if (is_name_token(state, 'M') == 4)
+                    state += month_field<month_format::month_name>::parse(&date_char, pack);
+                else if (is_name_token(state, 'M') == 3)
                     state += month_field<month_format::month_abbrev>::parse(&date_char, pack);
                 else
                     state += month_field<>::parse(&date_char, pack);
                 break;
+            case 'd':
+                if (is_name_token(state, 'd') == 4)
+                    state += weekday_field<weekday_format::weekday_name>::parse(&date_char, pack);
+                else if (is_name_token(state, 'd') == 3)
+                    state += weekday_field<>::parse(&date_char, pack);
+                else
+                    state += separator_field<>::parse(&date_char, pack);
+                break;
             case 'Y':
                 state += year_field<>::parse(&date_char, pack);
                 break;
@@ -182,7 +225,103 @@ static long long parse_datetime_string(const char *date, const char *format, dat
         }
         return datetime(pack.day, pack.month, pack.year, pack.hour, pack.minute, pack.second, pack.microsecond).data;
     }
-    return parse_datetime_string(date, "YYYY-MM-DDThh:mm:ss+00:00", date_format::text_date);
+    int length = 0;
+    while (date[length] != '\0') length++;
+    datetime result;
+    parse_iso8601(date, length, result);
+    return result.data;
+}
+
+// Advances past a two character token without stepping over the terminator
+static inline const char *next_token(const char *state) { return state + (state[1] != '\0' ? 2 : 1); }
+
+static parse_result parse_datetime_string_safe(const char *date, int length, const char *format, date_format group_format, long long &out) {
+    if (group_format == date_format::iso_date) {
+        datetime result;
+        const parse_result status = parse_iso8601(date, length, result);
+        out = result.data;
+        return status;
+    }
+    const char *state = format;
+    parse_cursor cursor = make_parse_cursor(date, length);
+    datetime_struct pack = make_checked_pack();
+    bool ok = true;
+    while (ok && *state != '\0') {
+        switch (*state) {
+        case 'M':
+            if (is_name_token(state, 'M') == 4) {
+                ok = month_field<month_format::month_name>::parse_checked(cursor, pack);
+                state += 4;
+            } else if (is_name_token(state, 'M') == 3) {
+                ok = month_field<month_format::month_abbrev>::parse_checked(cursor, pack);
+                state += 3;
+            } else {
+                ok = month_field<>::parse_checked(cursor, pack);
+                state = next_token(state);
+            }
+            break;
+        case 'd':
+            if (is_name_token(state, 'd') == 4) {
+                ok = weekday_field<weekday_format::weekday_name>::parse_checked(cursor, pack);
+                state += 4;
+            } else if (is_name_token(state, 'd') == 3) {
+                ok = weekday_field<>::parse_checked(cursor, pack);
+                state += 3;
+            } else {
+                goto separator;
+            }
+            break;
+        case 'Y': {
+            int count = 0;
+            while (state[count] == 'Y') count++;
+            if (count == 4) {
+                ok = year_field<year_four>::parse_checked(cursor, pack);
+            } else if (count == 2) {
+                ok = year_field<year_two>::parse_checked(cursor, pack);
+            } else {
+                ok = year_field<year_all>::parse_checked(cursor, pack);
+                if (count == 1 && state[1] == 'F')
+                    count++;
+            }
+            state += count;
+            break;
+        }
+        case 'D':
+            ok = day_field::parse_checked(cursor, pack);
+            state = next_token(state);
+            break;
+        case 'h':
+            ok = hour_field::parse_checked(cursor, pack);
+            state = next_token(state);
+            break;
+        case 'm':
+            ok = minute_field::parse_checked(cursor, pack);
+            state = next_token(state);
+            break;
+        case 's':
+            ok = second_field::parse_checked(cursor, pack);
+            state = next_token(state);
+            break;
+        case 'z':
+            ok = microsecond_field<>::parse_checked(cursor, pack);
+            while (*state == 'z') state++;
+            break;
+        default:
+        separator:
+            if (cursor.current == cursor.end)
+                ok = cursor.fail(parse_error::unexpected_end, cursor.current);
+            else if (*cursor.current != *state)
+                ok = cursor.fail(parse_error::expected_separator, cursor.current);
+            else
+                cursor.current++;
+            state++;
+            break;
+        }
+    }
+    if (!ok || !parse_checked_finish(cursor, pack))
+        return cursor.result;
+    out = datetime(pack.day, pack.month, pack.year, pack.hour, pack.minute, pack.second, pack.microsecond).data;
+    return {};
 }
 
 long long datetime_struct::to_datetime() { return seconds_since_epoch(day, month, year, hour, minute, second) * 1000000LL + microsecond; }
@@ -198,44 +337,31 @@ bool datetime::from_string(const char *date, const char *format, date_format gro
     return data != DATETIME_INVALID;
 }
 
+parse_result datetime::from_string_safe(const char *date, int length, const char *format, date_format group_format) {
+    data = DATETIME_INVALID;
+    return parse_datetime_string_safe(date, length, format, group_format, data);
+}
+
 bool datetime::to_string_format(char *out, const char *format, date_format group_format) const {
-    return datetime_to_string(*this, out, format, group_format);
+    datetime_to_string(*this, out, format, group_format);
+    return true;
 }
 
-void datetime::add_months(int months) {
-    datetime_struct pack;
-    to_pack(pack);
-    const int new_month = pack.month + months;
-
-    if (new_month > 12) {
-        pack.year = pack.year + new_month / 12;
-        pack.month = new_month % 12 == 0 ? 1 : new_month % 12;
-    } else if (new_month < 1) {
-        pack.year = pack.year + new_month / 12 - 1;
-        pack.month = 12 + new_month % 12;
-    } else {
-        pack.month = new_month;
-    }
-    if (pack.day > days_in_month[pack.month - 1]) {
-        pack.day = days_in_month[pack.month - 1];
-    }
-    *this = datetime(pack.day, pack.month, pack.year, pack.hour, pack.minute, pack.second, pack.microsecond);
+int datetime::format_to(char *out, const char *format, date_format group_format) const {
+    return datetime_to_string(*this, out, format, group_format);
 }
 
-void datetime::add_years(int years) {
-    datetime_struct pack;
-    to_pack(pack);
-    pack.year += years;
-    constexpr int february_in_leap = 29;
-    if (pack.day > days_in_month[pack.month - 1]) {
-        pack.day = days_in_month[pack.month - 1];
-    }
-    if (is_leap_year(pack.year) && pack.month == 2) {
-        pack.day = february_in_leap; // February in a leap year
-    }
-    *this = datetime(pack.day, pack.month, pack.year, pack.hour, pack.minute, pack.second, pack.microsecond);
+datetime_string<DATETIME_STRING_CAPACITY> datetime::to_string(const char *format, date_format group_format) const {
+    datetime_string<DATETIME_STRING_CAPACITY> result;
+    if (datetime_format_capacity(format, group_format) <= DATETIME_STRING_CAPACITY)
+        result.length = datetime_to_string(*this, result.buffer, format, group_format);
+    return result;
 }
 
+void datetime::add_months(int months) { data = datetime_add_months(data, months); }
+
+void datetime::add_years(int years) { data = datetime_add_years(data, years); }
+
 datetime datetime::begin_of_the_day() const { return this->data - (this->data % 86400000000LL); }
 
 datetime datetime::end_of_the_day() const { return begin_of_the_day() + 86399999999LL; }
@@ -274,24 +400,49 @@ bool datetime::different_year(datetime other) const {
     return pack1.year != pack2.year;
 }
 
-void datetime::to_pack(datetime_struct &pack) const { epoch_to_datetime_pack(data, pack); }
+void datetime::to_pack(datetime_struct &pack) const {
+#ifdef DATETIME_DECODE_TABLE
+    const bool decoded = datetime_decode_table_pack(data, pack);
+    DATETIME_INSTRUMENT_CACHE(decode_table, decoded);
+    if (decoded)
+        return;
+#endif
+    epoch_to_datetime_pack(data, pack);
+}
 
 int datetime::day() const {
-    datetime_struct pack;
-    epoch_to_datetime_pack(data, pack);
-    return pack.day;
+    const int days = datetime_day_number(data);
+#ifdef DATETIME_DECODE_TABLE
+    const datetime_decode_entry *entry = datetime_decode_table_instance.find(days);
+    DATETIME_INSTRUMENT_CACHE(decode_table, entry != nullptr);
+    if (entry != nullptr)
+        return entry->day();
+#endif
+    int year = 0, month = 0, day = 0;
+    civil_from_days(days, year, month, day);
+    return day;
 }
 
 int datetime::month() const {
-    datetime_struct pack;
-    epoch_to_datetime_pack(data, pack);
-    return pack.month;
+    const int days = datetime_day_number(data);
+#ifdef DATETIME_DECODE_TABLE
+    const datetime_decode_entry *entry = datetime_decode_table_instance.find(days);
+    DATETIME_INSTRUMENT_CACHE(decode_table, entry != nullptr);
+    if (entry != nullptr)
+        return entry->month();
+#endif
+    return month_from_days(days);
 }
 
 int datetime::year() const {
-    datetime_struct pack;
-    epoch_to_datetime_pack(data, pack);
-    return pack.year;
+    const int days = datetime_day_number(data);
+#ifdef DATETIME_DECODE_TABLE
+    const datetime_decode_entry *entry = datetime_decode_table_instance.find(days);
+    DATETIME_INSTRUMENT_CACHE(decode_table, entry != nullptr);
+    if (entry != nullptr)
+        return entry->year();
+#endif
+    return year_from_days(days);
 }
 
 int datetime::second() const {
@@ -341,21 +492,17 @@ int datetime::get_microsecond_of_day() const {
     return pack.hour * 3600 * 1000000 + pack.minute * 60 * 1000000 + pack.second * 1000000 + pack.microsecond;
 }
 
-int datetime::day_of_week() const {
-    datetime_struct pack;
-    epoch_to_datetime_pack(data, pack);
-    int month = pack.month;
-    int year = pack.year;
-    int day = pack.day;
-    if (month < 3) {
-        month += 12;
-        year--;
-    }
-    int K = year % 100;
-    int J = year / 100;
-    int h = (day + 13 * (month + 1) / 5 + K + K / 4 + J / 4 + 5 * J) % 7;
-    return (h + 6) % 7;
-}
+int datetime::day_of_week() const { return day_of_week_from_days(datetime_day_number(data)); }
+
+int datetime::day_of_year() const { return day_of_year_from_days(datetime_day_number(data)); }
+
+int datetime::iso_week() const { return iso_week_from_days(datetime_day_number(data)); }
+
+int datetime::iso_year() const { return iso_year_from_days(datetime_day_number(data)); }
+
+int datetime::quarter() const { return quarter_from_days(datetime_day_number(data)); }
+
+int datetime::week_of_month() const { return week_of_month_from_days(datetime_day_number(data)); }
 
 datetime datetime::date() const {
     datetime_struct pack;
@@ -391,54 +538,109 @@ unsigned int datetime::seconds_in_month() {
     return days * 86400;
 }
 
-unsigned long long datetime::seconds_in_range(int start_year, int start_month, int end_year, int end_month) {
-    const int seconds_per_day = 86400;
-    unsigned long long total_days = 0;
+// The loops the closed forms of seconds_in_range and the between helpers replaced, checked against them at compile
+// time over a sweep of years
+static constexpr unsigned long long reference_seconds_in_range(int start_year, int end_year) {
+    unsigned long long total_seconds = 0;
+    for (int year = start_year; year <= end_year; year++) total_seconds += (is_leap_year(year) ? 366ULL : 365ULL) * 86400ULL;
+    return total_seconds;
+}
 
+static constexpr unsigned long long reference_seconds_in_range(int start_year, int start_month, int end_year, int end_month) {
+    unsigned long long total_days = 0;
     if (start_year == end_year) {
-        int start_cumulative = monthdays[start_month - 1];
-        int end_cumulative = monthdays[end_month];
-        if (is_leap_year(start_year)) {
-            if (start_month > 2)
-                start_cumulative += 1;
-            if (end_month > 2)
-                end_cumulative += 1;
-        }
-        total_days = end_cumulative - start_cumulative;
+        total_days = (monthdays[end_month] + (is_leap_year(end_year) && end_month > 2)) -
+                     (monthdays[start_month - 1] + (is_leap_year(start_year) && start_month > 2));
     } else {
-        int start_cumulative = monthdays[start_month - 1];
-        if (is_leap_year(start_year) && start_month > 2)
-            start_cumulative += 1;
-        int days_in_start_year = is_leap_year(start_year) ? 366 : 365;
-        total_days += days_in_start_year - start_cumulative;
-
-        // For any full intermediate years, add all days.
-        for (int year = start_year + 1; year < end_year; ++year) {
-            total_days += is_leap_year(year) ? 366 : 365;
+        total_days += (is_leap_year(start_year) ? 366 : 365) - (monthdays[start_month - 1] + (is_leap_year(start_year) && start_month > 2));
+        for (int year = start_year + 1; year < end_year; ++year) total_days += is_leap_year(year) ? 366 : 365;
+        total_days += monthdays[end_month] + (is_leap_year(end_year) && end_month > 2);
+    }
+    return total_days * 86400ULL;
+}
+
+// Years around the leap rules and the epoch, and a sweep of negative and far years
+constexpr int reference_years[] = {-401, -400, -101, -100, -5, -4, -1, 0, 1, 4, 97, 100, 399, 400, 1599, 1600,
+                                   1700, 1899, 1900, 1968, 1969, 1970, 1972, 1999, 2000, 2023, 2024, 2100, 2400, 9999};
+
+// The loop missed February 29th when the range ended in a leap February
+static constexpr bool seconds_in_range_matches(int year, const int *spans, int span_count, bool all_months) {
+    for (int i = 0; i < span_count; i++) {
+        const int end_year = year + spans[i];
+        if (datetime::seconds_in_range(year, end_year) != reference_seconds_in_range(year, end_year) ||
+            datetime::seconds_in_range(end_year, year) != reference_seconds_in_range(end_year, year))
+            return false;
+        for (int start_month = 1; start_month <= 12; start_month += all_months ? 1 : 11) {
+            for (int end_month = spans[i] == 0 ? start_month : 1; end_month <= 12; end_month += all_months ? 1 : 1 + (end_month >= 3) * 8) {
+                const unsigned long long leap_february = is_leap_year(end_year) && end_month == 2 ? 86400ULL : 0ULL;
+                if (datetime::seconds_in_range(year, start_month, end_year, end_month) !=
+                    reference_seconds_in_range(year, start_month, end_year, end_month) + leap_february)
+                    return false;
+            }
         }
-        int end_cumulative = monthdays[end_month];
-        if (is_leap_year(end_year) && end_month > 2)
-            end_cumulative += 1;
-        total_days += end_cumulative;
     }
-
-    return total_days * seconds_per_day;
-}
-
-unsigned long long datetime::seconds_in_range(int start_year, int end_year) {
-    unsigned long long total_seconds = 0;
-    const int seconds_per_day = 86400;
-
-    for (int year = start_year; year <= end_year; year++) {
-        if (is_leap_year(year)) {
-            total_seconds += 366LL * seconds_per_day;
-        } else {
-            total_seconds += 365LL * seconds_per_day;
+    return true;
+}
+
+// Every month pair over short spans, the first and last months over spans of centuries. Split in halves to stay in
+// the compilers' constant evaluation limits.
+static constexpr bool seconds_in_range_sweep_matches(int first, int last) {
+    constexpr int short_spans[] = {0, 1, 2, 3, 4, 5};
+    constexpr int long_spans[] = {99, 100, 101, 399, 400, 401};
+    for (int i = first; i < last; i++)
+        if (!seconds_in_range_matches(reference_years[i], short_spans, 6, true) || !seconds_in_range_matches(reference_years[i], long_spans, 6, false))
+            return false;
+    return true;
+}
+
+static_assert(seconds_in_range_sweep_matches(0, 8), "seconds_in_range differs from the loops");
+static_assert(seconds_in_range_sweep_matches(8, 16), "seconds_in_range differs from the loops");
+static_assert(seconds_in_range_sweep_matches(16, 24), "seconds_in_range differs from the loops");
+static_assert(seconds_in_range_sweep_matches(24, 30), "seconds_in_range differs from the loops");
+
+// The between helpers chained their divisions and months_in_between unpacked both dates
+static constexpr long long reference_months_in_between(datetime dt1, datetime dt2) {
+    int year1 = 0, month1 = 0, day1 = 0, year2 = 0, month2 = 0, day2 = 0;
+    civil_from_days(datetime_day_number(dt1.data), year1, month1, day1);
+    civil_from_days(datetime_day_number(dt2.data), year2, month2, day2);
+    const int month_diff = year1 > year2 ? month1 - month2 : month2 - month1;
+    return (year2 - year1) * 12LL + month_diff;
+}
+
+static constexpr bool in_between_matches(datetime dt1, datetime dt2) {
+    const long long seconds = (dt2.data - dt1.data) / 1000000LL;
+    const long long minutes = seconds / 60LL;
+    const long long hours = minutes / 60LL;
+    const long long days = hours / 24LL;
+    // Spans going back over a year boundary took the month difference the wrong way round, they are now the
+    // negated forward span
+    const bool backwards = datetime_day_number(dt1.data) > datetime_day_number(dt2.data);
+    const long long months = backwards ? -reference_months_in_between(dt2, dt1) : reference_months_in_between(dt1, dt2);
+    return seconds_in_between(dt1, dt2) == seconds && minutes_in_between(dt1, dt2) == minutes && hours_in_between(dt1, dt2) == hours &&
+           days_in_between(dt1, dt2) == days && months_in_between(dt1, dt2) == months && years_in_between(dt1, dt2) == months / 12 &&
+           (backwards || reference_months_in_between(dt1, dt2) == months);
+}
+
+static constexpr bool in_between_sweep_matches(int first, int last) {
+    constexpr long long day = DATETIME_MICROSECONDS_PER_DAY;
+    constexpr long long offsets[] = {0, 1, 58 * day + 12345678901LL, 59 * day, 364 * day + day - 1};
+    constexpr long long deltas[] = {0,         1,          -1,            999999,  -1000000,    59999999,      -60000000,
+                                    3599999999, -3600000000LL, day - 1,     -day - 1, 31 * day + 5, -40 * day - 7, 365 * day,
+                                    -366 * day - 1, 146097 * day + 86399999999LL};
+    for (int i = first; i < last; i++) {
+        for (long long offset : offsets) {
+            const long long start = datetime_days_before_year(reference_years[i]) * day + offset;
+            for (long long delta : deltas)
+                if (!in_between_matches(datetime(start), datetime(start + delta)))
+                    return false;
         }
     }
-    return total_seconds;
+    return true;
 }
 
+static_assert(in_between_sweep_matches(0, 15), "the between helpers differ from the chained divisions");
+static_assert(in_between_sweep_matches(15, 30), "the between helpers differ from the chained divisions");
+
 int datetime::day_of_week(int day, int month, int year) {
     if (month < 3) {
         month += 12;
@@ -522,6 +724,7 @@ datetime datetime::begin_of_the_week() const {
 
 #ifdef HAS_STD_CHRONO
 datetime datetime::now() {
+    DATETIME_INSTRUMENT_CALL(now);
     return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
 #endif
@@ -1,6 +1,13 @@
 #ifndef GTR_DATETIME_H
 #define GTR_DATETIME_H
 #define HAS_STD_CHRONO
+#define HAS_STD_STRING_VIEW
+#ifdef HAS_STD_STRING_VIEW
+#include <string_view>
+#endif
+#if defined(_MSC_VER) && !defined(__GNUC__)
+#include <intrin.h>
+#endif
 namespace gtr {
 
 /**
@@ -21,7 +28,140 @@ enum class date_format { text_date, iso_date };
 /**
  * @brief The format options for month representation.
  */
-enum class month_format { month_digits, month_abbrev };
+enum class month_format { month_digits, month_abbrev, month_name };
+
+/**
+ * @brief The reasons a checked parse can fail.
+ */
+enum class parse_error {
+    none,                /**< The input was parsed successfully. */
+    unexpected_end,      /**< The input ended before the format did. */
+    expected_digit,      /**< A numeric field holds a character that is not a digit. */
+    expected_separator,  /**< The input does not match a separator of the format. */
+    invalid_year,        /**< The year is outside 1 - 290000. */
+    invalid_month,       /**< The month is not 1 - 12 or not a known name. */
+    invalid_day,         /**< The day does not exist in the month. */
+    invalid_hour,        /**< The hour is not 0 - 23. */
+    invalid_minute,      /**< The minute is not 0 - 59. */
+    invalid_second,      /**< The second is not 0 - 59. */
+    invalid_microsecond, /**< The fraction has more than six digits. */
+    trailing_characters, /**< The input continues after the format ended. */
+    invalid_offset,      /**< The UTC offset is not -23:59 - +23:59. */
+    invalid_weekday,     /**< The weekday name is not a known day. */
+    invalid_epoch,       /**< The epoch number has too many digits or does not fit a datetime. */
+};
+
+/**
+ * @brief The outcome of a checked parse.
+ */
+struct parse_result {
+    parse_error error{parse_error::none}; /**< parse_error::none on success. */
+    int position{0};                      /**< The byte offset of the input where the error was detected. */
+
+    inline constexpr explicit operator bool() const { return error == parse_error::none; }
+};
+
+/**
+ * @brief The capacity of the strings returned by datetime::to_string with a runtime format.
+ */
+constexpr int DATETIME_STRING_CAPACITY = 64;
+
+/**
+ * @brief A fixed-capacity string holding a formatted datetime.
+ *
+ * The characters are stored inline so formatting never touches the heap. The buffer is always
+ * null terminated, so it can be handed to C APIs as well as used as a std::string_view.
+ *
+ * @tparam Capacity The maximum number of characters, not counting the terminator.
+ */
+template <int Capacity> struct datetime_string {
+    char buffer[Capacity + 1]{}; /**< The characters followed by a terminator. */
+    int length{0};               /**< The number of characters written. */
+
+    inline constexpr const char *c_str() const { return buffer; }
+    inline constexpr const char *data() const { return buffer; }
+    inline constexpr int size() const { return length; }
+    inline constexpr bool empty() const { return length == 0; }
+    static inline constexpr int capacity() { return Capacity; }
+    inline constexpr const char *begin() const { return buffer; }
+    inline constexpr const char *end() const { return buffer + length; }
+    inline constexpr char operator[](int index) const { return buffer[index]; }
+
+#ifdef HAS_STD_STRING_VIEW
+    inline constexpr operator std::string_view() const { return {buffer, static_cast<std::string_view::size_type>(length)}; }
+    inline constexpr std::string_view view() const { return *this; }
+#endif
+};
+
+/**
+ * @brief Computes the maximum number of characters a format string can produce.
+ *
+ * Mirrors the token grammar of datetime::to_string_format, assuming the widest value for every
+ * field (e.g. a negative six digit year for YF).
+ *
+ * @param format The format of the datetime string.
+ * @param group_format The format of the date component in the datetime string.
+ * @return The maximum length of the formatted string, not counting the terminator.
+ */
+constexpr int datetime_format_capacity(const char *format, date_format group_format = date_format::text_date) {
+    if (group_format == date_format::iso_date)
+        return datetime_format_capacity("YF-MM-DDThh:mm:ss+00:00");
+    int size = 0;
+    while (*format != '\0') {
+        switch (*format) {
+        case 'Y':
+            if (format[1] == 'Y' && format[2] == 'Y') {
+                size += 5;
+                format += 4;
+            } else if (format[1] == 'Y') {
+                size += 3;
+                format += 2;
+            } else if (format[1] == 'F') {
+                size += 7;
+                format += 2;
+            } else {
+                format++;
+            }
+            break;
+        case 'M':
+            if (format[1] == 'M' && format[2] == 'M' && format[3] == 'M') {
+                size += 9;
+                format += 4;
+            } else if (format[1] == 'M' && format[2] == 'M') {
+                size += 3;
+                format += 3;
+            } else {
+                size += 2;
+                format += format[1] != '\0' ? 2 : 1;
+            }
+            break;
+        case 'd':
+            if (format[1] == 'd' && format[2] == 'd' && format[3] == 'd') {
+                size += 9;
+                format += 4;
+            } else if (format[1] == 'd' && format[2] == 'd') {
+                size += 3;
+                format += 3;
+            } else {
+                size++;
+                format++;
+            }
+            break;
+        case 'D':
+        case 'h':
+        case 'm':
+        case 's':
+            size += 2;
+            format += format[1] != '\0' ? 2 : 1;
+            break;
+        default:
+            size++;
+            format++;
+            break;
+        }
+    }
+    return size;
+}
 
 /**
  * @brief A structure representing the components of a datetime.
@@ -62,6 +202,64 @@ enum class common_timezones : int {
     BRT = -3, /**< Brasilia Time (UTC-3). */
 };
 
+// Number of zero bits below the lowest set bit, value must not be 0
+inline int datetime_count_trailing_zeros(unsigned long long value) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(value);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#else
+    int count = 0;
+    while ((value & 1) == 0) {
+        value >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Number of zero bits above the highest set bit, value must not be 0
+inline int datetime_count_leading_zeros(unsigned long long value) {
+#if defined(__GNUC__)
+    return __builtin_clzll(value);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return 63 - static_cast<int>(index);
+#else
+    int count = 0;
+    while ((value >> 63) == 0) {
+        value <<= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Leap years from a fixed year, a multiple of 400 years in the past, through year - 1.
+// Starting on a whole era keeps the divisions flooring for negative years.
+constexpr inline long long datetime_leap_years_before(long long year) {
+    const long long shifted = year - 1 + 400000;
+    return shifted / 4 - shifted / 100 + shifted / 400;
+}
+
+/**
+ * @brief Returns the number of days from January 1st 1970 to January 1st of the year, in constant time.
+ */
+constexpr inline long long datetime_days_before_year(long long year) {
+    return (year - 1970) * 365 + datetime_leap_years_before(year) - datetime_leap_years_before(1970);
+}
+
+/**
+ * @brief Returns the number of days from January 1st to the first day of the month, month 13 gives the year length.
+ */
+constexpr inline int datetime_days_before_month(long long year, int month) {
+    const int leap = (year % 4 == 0) & ((year % 100 != 0) | (year % 400 == 0));
+    return (367 * month - 362) / 12 - (month > 2 ? 2 - leap : 0);
+}
+
 /**
  * @brief A class representing a datetime.
  * Holds the microseconds count since epoch in UTC+0
@@ -123,6 +321,43 @@ struct datetime {
      */
     bool to_string_format(char *out, const char *format = DATETIME_DEFAULT_FORMAT, date_format group_format = date_format::text_date) const;
 
+    /**
+     * @brief Converts the datetime to a string representation.
+     * @param out The output buffer to store the string representation.
+     * @param format The format of the datetime string. Default is DATETIME_DEFAULT_FORMAT.
+     * @param group_format The format of the date component in the datetime string. Default is date_format::text_date.
+     * @return The number of characters written, not counting the terminator.
+     */
+    int format_to(char *out, const char *format = DATETIME_DEFAULT_FORMAT, date_format group_format = date_format::text_date) const;
+
+    /**
+     * @brief Converts the datetime to an inline string without allocating.
+     * @param format The format of the datetime string. Default is DATETIME_DEFAULT_FORMAT.
+     * @param group_format The format of the date component in the datetime string. Default is date_format::text_date.
+     * @return The formatted string, or an empty string if the format could exceed DATETIME_STRING_CAPACITY.
+     */
+    datetime_string<DATETIME_STRING_CAPACITY> to_string(const char *format = DATETIME_DEFAULT_FORMAT,
+                                                        date_format group_format = date_format::text_date) const;
+
+    /**
+     * @brief Converts the datetime to an inline string sized from the format at compile time.
+     *
+     * The format must have static storage duration, e.g.
+     *
+     *     static constexpr char log_format[] = "YYYY-MM-DD hh:mm:ss.zzzzzz";
+     *     auto text = dt.to_string<log_format>();
+     *
+     * @tparam Format The format of the datetime string.
+     * @tparam GroupFormat The format of the date component in the datetime string.
+     * @return The formatted string.
+     */
+    template <const char *Format, date_format GroupFormat = date_format::text_date>
+    datetime_string<datetime_format_capacity(Format, GroupFormat)> to_string() const {
+        datetime_string<datetime_format_capacity(Format, GroupFormat)> result;
+        result.length = format_to(result.buffer, Format, GroupFormat);
+        return result;
+    }
+
     /**
      * @brief Converts a string representation to a datetime.
      * @param date The string representation of the datetime.
@@ -132,6 +367,22 @@ struct datetime {
      */
     bool from_string(const char *date, const char *format = DATETIME_DEFAULT_FORMAT, date_format group_format = date_format::text_date);
 
+    /**
+     * @brief Converts a length bounded, untrusted string to a datetime.
+     *
+     * Unlike from_string every field is bounds, digit and range checked (including the days of the month and leap years)
+     * and separators must match the format. Never reads past date + length. Fields missing from the format default to 01/01/1970 00:00:00.
+     * YYYY and YY take exactly four and two digits, YF one to six digits and z one to six digits.
+     *
+     * @param date The string representation of the datetime, does not need to be null terminated.
+     * @param length The number of characters of date.
+     * @param format The format of the datetime string. Default is DATETIME_DEFAULT_FORMAT.
+     * @param group_format The format of the date component in the datetime string. Default is date_format::text_date.
+     * @return The error and its byte position. On failure the datetime is set to DATETIME_INVALID.
+     */
+    parse_result from_string_safe(const char *date, int length, const char *format = DATETIME_DEFAULT_FORMAT,
+                                  date_format group_format = date_format::text_date);
+
     /**
      * @brief Converts the datetime to a datetime_pack structure.
      * @param pack The datetime_pack structure to store the components of the datetime.
@@ -185,14 +436,19 @@ struct datetime {
     inline constexpr void add_days(int days) { data += days * 86400 * 1000000LL; }
 
     /**
-     * @brief Adds the specified number of months to the datetime.
-     * @param months The number of months to add.
+     * @brief Adds the specified number of months to the datetime, keeping the time of day.
+     *
+     * A day past the end of the target month is clamped to its last day, e.g. January 31st + 1 month is February 28th
+     * (29th in a leap year). See add_months_bulk in datetime_calendar.h for arrays.
+     * @param months The number of months to add, may be negative.
      */
     void add_months(int months);
 
     /**
-     * @brief Adds the specified number of years to the datetime.
-     * @param years The number of years to add.
+     * @brief Adds the specified number of years to the datetime, keeping the time of day.
+     *
+     * February 29th becomes February 28th when the target year is not a leap year.
+     * @param years The number of years to add, may be negative.
      */
     void add_years(int years);
 
@@ -262,6 +518,36 @@ struct datetime {
      */
     int day_of_week() const;
 
+    /**
+     * @brief Gets the day of the year for the datetime.
+     * @return The day of the year (1 - 366).
+     */
+    int day_of_year() const;
+
+    /**
+     * @brief Gets the ISO 8601 week number for the datetime.
+     * @return The week number (1 - 53), weeks starting on Monday.
+     */
+    int iso_week() const;
+
+    /**
+     * @brief Gets the ISO 8601 week-numbering year for the datetime.
+     * @return The year the ISO week belongs to, which may differ from year() near January 1st.
+     */
+    int iso_year() const;
+
+    /**
+     * @brief Gets the quarter of the year for the datetime.
+     * @return The quarter (1 - 4).
+     */
+    int quarter() const;
+
+    /**
+     * @brief Gets the week of the month for the datetime.
+     * @return The week of the month (1 - 6), weeks starting on Sunday.
+     */
+    int week_of_month() const;
+
     /**
      * @brief Gets the day of the year for the datetime.
      * @return The day of the year for the datetime.
@@ -404,14 +690,26 @@ struct datetime {
     bool leap_year();
 
     /**
-     * @brief Computes the number of seconds cumulative in the range
+     * @brief Computes the number of seconds in the years start_year through end_year, in constant time.
+     * @return 0 if end_year is before start_year.
      */
-    static unsigned long long seconds_in_range(int start_year, int end_year);
+    static inline constexpr unsigned long long seconds_in_range(int start_year, int end_year) {
+        if (end_year < start_year)
+            return 0;
+        return static_cast<unsigned long long>(datetime_days_before_year(end_year + 1LL) - datetime_days_before_year(start_year)) * 86400ULL;
+    }
 
     /**
-     * @brief Computes the number of seconds cumulative in the range
+     * @brief Computes the number of seconds from the start of start_month to the end of end_month, in constant time.
+     *
+     * The end month must not be before the start month. A range ending in a leap February counts February 29th, the
+     * loop this replaced left it out.
      */
-    static unsigned long long seconds_in_range(int start_year, int start_month, int end_year, int end_month);
+    static inline constexpr unsigned long long seconds_in_range(int start_year, int start_month, int end_year, int end_month) {
+        const long long start = datetime_days_before_year(start_year) + datetime_days_before_month(start_year, start_month);
+        const long long end = datetime_days_before_year(end_year) + datetime_days_before_month(end_year, end_month + 1);
+        return static_cast<unsigned long long>(end - start) * 86400ULL;
+    }
 
     /**
      * @brief Returns the number a seconds the current month holds
@@ -0,0 +1,691 @@
+// Self-contained benchmarks for the datetime library.
+//
+//   ./datetime_bench [--filter <substring>] [--json <file>] [--perf] [--repetitions <n>] [--iterations <n>]
+//
+// Every benchmark prints ns/op and throughput to stderr, the JSON report goes to stdout (or --json <file>).
+// --perf adds cycles, instructions, branch and cache misses per op through perf_event_open on Linux.
+#define DATETIME_PERFECT_PARSER
+#include "datetime.h"
+#include "datetime_calendar.h"
+#include "datetime_clock.h"
+#include "datetime_decode_table.h"
+#include "datetime_detect.h"
+#include "datetime_epoch.h"
+#include "datetime_index.h"
+#include "datetime_interval.h"
+#include "datetime_iso8601.h"
+#include "datetime_join.h"
+#include "datetime_merge.h"
+#include "datetime_parser.h"
+#include "datetime_recurrence.h"
+#include "datetime_serial.h"
+#include "datetime_series.h"
+#include "datetime_shared_clock.h"
+#include "datetime_timer_wheel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define DATETIME_BENCH_POSIX
+#endif
+
+using namespace gtr;
+
+namespace {
+
+constexpr int input_count = 4096; // power of two, indexes wrap with a mask
+
+struct perf_counters {
+    static constexpr int count = 4;
+    int fds[count] = {-1, -1, -1, -1};
+    bool enabled = false;
+
+    void open() {
+#if defined(__linux__)
+        const unsigned long long configs[count] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES,
+                                                   PERF_COUNT_HW_CACHE_MISSES};
+        enabled = true;
+        for (int i = 0; i < count; i++) {
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+            if (fds[i] < 0)
+                enabled = false;
+        }
+        if (!enabled) {
+            std::fprintf(stderr, "perf_event_open unavailable, hardware counters disabled\n");
+            close();
+        }
+#endif
+    }
+
+    void close() {
+#if defined(__linux__)
+        for (int &fd : fds) {
+            if (fd >= 0)
+                ::close(fd);
+            fd = -1;
+        }
+#endif
+    }
+
+    void start() {
+#if defined(__linux__)
+        if (!enabled)
+            return;
+        for (int fd : fds) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void stop(unsigned long long (&values)[count]) {
+        for (unsigned long long &value : values) value = 0;
+#if defined(__linux__)
+        if (!enabled)
+            return;
+        for (int i = 0; i < count; i++) {
+            ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+                values[i] = 0;
+        }
+#endif
+    }
+};
+
+struct result {
+    std::string name;
+    double ns_per_op;
+    double ops_per_second;
+    long long iterations;
+    double counters[perf_counters::count];
+};
+
+struct options {
+    const char *filter = nullptr;
+    const char *json_path = nullptr;
+    bool perf = false;
+    int repetitions = 5;
+    long long iterations = 1 << 20;
+};
+
+volatile long long sink;
+
+class runner {
+  public:
+    explicit runner(const options &opts) : opts_(opts) {
+        if (opts_.perf)
+            counters_.open();
+    }
+    ~runner() { counters_.close(); }
+
+    // Runs `op(i)` for the configured iterations and keeps the fastest repetition
+    template <class Op> void run(const char *name, Op op) {
+        if (opts_.filter && std::strstr(name, opts_.filter) == nullptr)
+            return;
+        const long long iterations = opts_.iterations;
+        long long accumulator = 0;
+        for (long long i = 0; i < iterations / 16; i++) accumulator += op(i); // warm up
+        result best{name, 0, 0, iterations, {}};
+        double best_ns = -1;
+        for (int rep = 0; rep < opts_.repetitions; rep++) {
+            unsigned long long values[perf_counters::count];
+            counters_.start();
+            const auto begin = std::chrono::steady_clock::now();
+            for (long long i = 0; i < iterations; i++) accumulator += op(i);
+            const auto end = std::chrono::steady_clock::now();
+            counters_.stop(values);
+            const double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+            if (best_ns < 0 || ns < best_ns) {
+                best_ns = ns;
+                for (int c = 0; c < perf_counters::count; c++) best.counters[c] = static_cast<double>(values[c]) / iterations;
+            }
+        }
+        sink = accumulator;
+        best.ns_per_op = best_ns / iterations;
+        best.ops_per_second = best.ns_per_op > 0 ? 1e9 / best.ns_per_op : 0;
+        std::fprintf(stderr, "%-36s %10.2f ns/op %14.0f ops/s", name, best.ns_per_op, best.ops_per_second);
+        if (counters_.enabled)
+            std::fprintf(stderr, " %8.1f cyc %8.1f ins %6.2f br-miss %6.2f cache-miss", best.counters[0], best.counters[1],
+                         best.counters[2], best.counters[3]);
+        std::fprintf(stderr, "\n");
+        results_.push_back(best);
+    }
+
+    bool write_json() const {
+        FILE *out = opts_.json_path ? std::fopen(opts_.json_path, "w") : stdout;
+        if (out == nullptr) {
+            std::fprintf(stderr, "cannot open %s\n", opts_.json_path);
+            return false;
+        }
+        std::fprintf(out, "{\n  \"context\": {\"repetitions\": %d, \"iterations\": %lld, \"perf_counters\": %s},\n", opts_.repetitions,
+                     opts_.iterations, counters_.enabled ? "true" : "false");
+        std::fprintf(out, "  \"benchmarks\": [\n");
+        for (size_t i = 0; i < results_.size(); i++) {
+            const result &r = results_[i];
+            std::fprintf(out, "    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"ops_per_second\": %.0f, \"iterations\": %lld", r.name.c_str(),
+                         r.ns_per_op, r.ops_per_second, r.iterations);
+            if (counters_.enabled)
+                std::fprintf(out,
+                             ", \"cycles_per_op\": %.3f, \"instructions_per_op\": %.3f, \"branch_misses_per_op\": %.4f, "
+                             "\"cache_misses_per_op\": %.4f",
+                             r.counters[0], r.counters[1], r.counters[2], r.counters[3]);
+            std::fprintf(out, "}%s\n", i + 1 < results_.size() ? "," : "");
+        }
+        std::fprintf(out, "  ]\n}\n");
+        if (out != stdout)
+            std::fclose(out);
+        return true;
+    }
+
+  private:
+    options opts_;
+    perf_counters counters_;
+    std::vector<result> results_;
+};
+
+bool parse_options(int argc, char **argv, options &opts) {
+    for (int i = 1; i < argc; i++) {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--filter") == 0 && has_value) {
+            opts.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--json") == 0 && has_value) {
+            opts.json_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--perf") == 0) {
+            opts.perf = true;
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && has_value) {
+            opts.repetitions = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--iterations") == 0 && has_value) {
+            opts.iterations = std::max(1LL, std::atoll(argv[++i]));
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--filter <substring>] [--json <file>] [--perf] [--repetitions <n>] [--iterations <n>]\n",
+                         argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+// A timer scheduled already due from inside fire is fired by the same advance, not when the wheel wraps around
+bool timer_wheel_fires_rescheduled() {
+    timer_wheel wheel(0LL, 1);
+    wheel.schedule(5LL, 1);
+    wheel.schedule(10LL, 2);
+    long long fired = 0;
+    wheel.advance_to(1000LL, [&](timer_id, unsigned long long payload) {
+        fired++;
+        if (payload == 1)
+            wheel.schedule(5LL, 3);
+    });
+    return fired == 3 && wheel.size() == 0;
+}
+
+using iso_parser = perfect_parser<year_field<>, separator_field<1, '-'>, month_field<>, separator_field<1, '-'>, day_field,
+                                  separator_field<1, ' '>, hour_field, separator_field<>, minute_field, separator_field<>, second_field,
+                                  separator_field<1, '.'>, microsecond_field<6>>;
+
+constexpr char iso_format[] = "YYYY-MM-DD hh:mm:ss.zzzzzz";
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opts;
+    if (!parse_options(argc, argv, opts))
+        return 1;
+
+    // Inputs between 1970 and 2100, the range most production data falls in
+    std::mt19937_64 rng(42);
+    std::vector<datetime> dates(input_count);
+    std::vector<std::string> default_strings(input_count), iso_strings(input_count), rfc3339_strings(input_count), epoch_strings(input_count);
+    std::vector<datetime_struct> packs(input_count);
+    for (int i = 0; i < input_count; i++) {
+        dates[i] = datetime(static_cast<long long>(rng() % 4102444800000000ULL));
+        char buffer[64];
+        dates[i].to_string_format(buffer);
+        default_strings[i] = buffer;
+        dates[i].to_string_format(buffer, iso_format);
+        iso_strings[i] = buffer;
+        iso8601_format rfc3339;
+        rfc3339.fraction_digits = 6;
+        format_iso8601(dates[i], buffer, rfc3339);
+        rfc3339_strings[i] = buffer;
+        format_epoch(dates[i], buffer, epoch_unit::microseconds);
+        epoch_strings[i] = buffer;
+        dates[i].to_pack(packs[i]);
+    }
+    constexpr long long mask = input_count - 1;
+    char out[64];
+
+    runner bench(opts);
+
+    // Parse
+    bench.run("parse/runtime_default", [&](long long i) { return datetime(default_strings[i & mask].c_str()).data; });
+    bench.run("parse/perfect_parser_default",
+              [&](long long i) { return perfect_parser_default::parse_datetime(default_strings[i & mask].c_str()).data; });
+    bench.run("parse/runtime_iso", [&](long long i) { return datetime(iso_strings[i & mask].c_str(), iso_format).data; });
+    bench.run("parse/perfect_parser_iso", [&](long long i) { return iso_parser::parse_datetime(iso_strings[i & mask].c_str()).data; });
+    bench.run("parse/runtime_iso_safe", [&](long long i) {
+        const std::string &text = iso_strings[i & mask];
+        datetime dt;
+        dt.from_string_safe(text.data(), static_cast<int>(text.size()), iso_format);
+        return dt.data;
+    });
+    bench.run("parse/perfect_parser_iso_safe", [&](long long i) {
+        const std::string &text = iso_strings[i & mask];
+        parse_result result;
+        return iso_parser::parse_datetime_safe(text.data(), static_cast<int>(text.size()), result).data;
+    });
+    bench.run("parse/iso8601", [&](long long i) {
+        const std::string &text = rfc3339_strings[i & mask];
+        datetime dt;
+        parse_iso8601(text.data(), static_cast<int>(text.size()), dt);
+        return dt.data;
+    });
+    bench.run("parse/epoch_autodetect", [&](long long i) {
+        const std::string &text = epoch_strings[i & mask];
+        datetime dt;
+        parse_epoch(text.data(), static_cast<int>(text.size()), dt);
+        return dt.data;
+    });
+    bench.run("parse/epoch_strtoll", [&](long long i) { return std::strtoll(epoch_strings[i & mask].c_str(), nullptr, 10); });
+    compiled_format compiled_iso;
+    compiled_iso.compile(iso_format);
+    bench.run("parse/compiled_format_iso", [&](long long i) {
+        const std::string &text = iso_strings[i & mask];
+        datetime dt;
+        compiled_iso.parse(text.data(), static_cast<int>(text.size()), dt);
+        return dt.data;
+    });
+    // Homogeneous input amortizes to the last format, mixed input dispatches on the signature
+    multi_format_parser vendors;
+    vendors.add("DD/MM/YYYY hh:mm:ss");
+    vendors.add("ddd, DD MMM YYYY hh:mm:ss");
+    vendors.add(iso_format);
+    vendors.add("", date_format::iso_date);
+    bench.run("parse/multi_format_homogeneous", [&](long long i) {
+        const std::string &text = iso_strings[i & mask];
+        datetime dt;
+        vendors.parse(text.data(), static_cast<int>(text.size()), dt);
+        return dt.data;
+    });
+    bench.run("parse/multi_format_mixed", [&](long long i) {
+        const std::string &text = (i & 1) != 0 ? iso_strings[i & mask] : (i & 2) != 0 ? default_strings[i & mask] : rfc3339_strings[i & mask];
+        datetime dt;
+        vendors.parse(text.data(), static_cast<int>(text.size()), dt);
+        return dt.data;
+    });
+    bench.run("parse/from_string_safe_trial", [&](long long i) {
+        // The trial and error this replaces: every candidate format in turn
+        const std::string &text = (i & 1) != 0 ? iso_strings[i & mask] : (i & 2) != 0 ? default_strings[i & mask] : rfc3339_strings[i & mask];
+        static const char *const candidates[] = {"DD/MM/YYYY hh:mm:ss", "ddd, DD MMM YYYY hh:mm:ss", iso_format};
+        datetime dt;
+        for (const char *candidate : candidates) {
+            if (dt.from_string_safe(text.data(), static_cast<int>(text.size()), candidate))
+                return dt.data;
+        }
+        dt.from_string_safe(text.data(), static_cast<int>(text.size()), "", date_format::iso_date);
+        return dt.data;
+    });
+#ifdef DATETIME_BENCH_POSIX
+    bench.run("parse/strptime_timegm", [&](long long i) {
+        tm t{};
+        strptime(default_strings[i & mask].c_str(), "%d/%m/%Y %H:%M:%S", &t);
+        return static_cast<long long>(timegm(&t));
+    });
+#endif
+
+    // Format
+    bench.run("format/runtime_default", [&](long long i) {
+        dates[i & mask].to_string_format(out);
+        return static_cast<long long>(out[4]);
+    });
+    bench.run("format/perfect_parser_default", [&](long long i) {
+        perfect_parser_default::put_datetime(dates[i & mask], out);
+        return static_cast<long long>(out[4]);
+    });
+    bench.run("format/runtime_iso", [&](long long i) {
+        dates[i & mask].to_string_format(out, iso_format);
+        return static_cast<long long>(out[4]);
+    });
+    bench.run("format/perfect_parser_iso", [&](long long i) {
+        iso_parser::put_datetime(dates[i & mask], out);
+        return static_cast<long long>(out[4]);
+    });
+    bench.run("format/iso8601", [&](long long i) {
+        iso8601_format rfc3339;
+        rfc3339.fraction_digits = 6;
+        return static_cast<long long>(format_iso8601(dates[i & mask], out, rfc3339));
+    });
+    bench.run("format/epoch_seconds_fraction",
+              [&](long long i) { return static_cast<long long>(format_epoch(dates[i & mask], out, epoch_unit::seconds, 6)); });
+    bench.run("format/to_string_template_iso", [&](long long i) { return static_cast<long long>(dates[i & mask].to_string<iso_format>()[4]); });
+#ifdef DATETIME_BENCH_POSIX
+    bench.run("format/gmtime_r_strftime", [&](long long i) {
+        const time_t seconds = static_cast<time_t>(dates[i & mask].data / 1000000LL);
+        tm t;
+        gmtime_r(&seconds, &t);
+        return static_cast<long long>(strftime(out, sizeof(out), "%d/%m/%Y %H:%M:%S", &t));
+    });
+#endif
+
+    // Decode
+    bench.run("decode/to_pack", [&](long long i) {
+        datetime_struct pack;
+        dates[i & mask].to_pack(pack);
+        return static_cast<long long>(pack.day + pack.second);
+    });
+    bench.run("decode/arithmetic", [&](long long i) {
+        int year, month, day;
+        civil_from_days(datetime_day_number(dates[i & mask].data), year, month, day);
+        return static_cast<long long>(year + month + day);
+    });
+    bench.run("decode/table", [&](long long i) {
+        datetime_struct pack{};
+        datetime_decode_table_pack(dates[i & mask].data, pack);
+        return static_cast<long long>(pack.day + pack.second);
+    });
+    bench.run("decode/year", [&](long long i) { return static_cast<long long>(dates[i & mask].year()); });
+    bench.run("decode/day_of_week", [&](long long i) { return static_cast<long long>(dates[i & mask].day_of_week()); });
+#ifdef DATETIME_BENCH_POSIX
+    bench.run("decode/gmtime_r", [&](long long i) {
+        const time_t seconds = static_cast<time_t>(dates[i & mask].data / 1000000LL);
+        tm t;
+        gmtime_r(&seconds, &t);
+        return static_cast<long long>(t.tm_mday + t.tm_sec);
+    });
+#endif
+
+    // Encode
+    bench.run("encode/constructor", [&](long long i) {
+        const datetime_struct &p = packs[i & mask];
+        return datetime(p.day, p.month, p.year, p.hour, p.minute, p.second, p.microsecond).data;
+    });
+    bench.run("encode/days_from_civil", [&](long long i) {
+        const datetime_struct &p = packs[i & mask];
+        return static_cast<long long>(days_from_civil(p.year, p.month, p.day));
+    });
+#ifdef DATETIME_BENCH_POSIX
+    bench.run("encode/timegm", [&](long long i) {
+        const datetime_struct &p = packs[i & mask];
+        tm t{};
+        t.tm_year = p.year - 1900;
+        t.tm_mon = p.month - 1;
+        t.tm_mday = p.day;
+        t.tm_hour = p.hour;
+        t.tm_min = p.minute;
+        t.tm_sec = p.second;
+        return static_cast<long long>(timegm(&t));
+    });
+#endif
+
+    // Arithmetic
+    bench.run("arithmetic/add_months", [&](long long i) {
+        datetime dt = dates[i & mask];
+        dt.add_months(static_cast<int>(i & 31) - 16);
+        return dt.data;
+    });
+    bench.run("arithmetic/add_years", [&](long long i) {
+        datetime dt = dates[i & mask];
+        dt.add_years(static_cast<int>(i & 15) - 8);
+        return dt.data;
+    });
+    // One op is 16 dates
+    datetime shifted[16];
+    bench.run("arithmetic/add_months_bulk_16", [&](long long i) {
+        add_months_bulk(&dates[(i * 16) & mask], shifted, 16, static_cast<int>(i & 31) - 16);
+        return shifted[i & 15].data;
+    });
+
+    // Other time systems, one op is 16 dates
+    double serials[16];
+    unsigned long long ntp_stamps[16];
+    bench.run("serial/to_excel_bulk_16", [&](long long i) {
+        to_excel_bulk(&dates[(i * 16) & mask], serials, 16);
+        return static_cast<long long>(serials[i & 15]);
+    });
+    bench.run("serial/from_excel_bulk_16", [&](long long i) {
+        from_excel_bulk(serials, shifted, 16);
+        return shifted[i & 15].data;
+    });
+    bench.run("serial/to_ntp_bulk_16", [&](long long i) {
+        to_ntp_bulk(&dates[(i * 16) & mask], ntp_stamps, 16);
+        return static_cast<long long>(ntp_stamps[i & 15]);
+    });
+    bench.run("serial/from_ntp_bulk_16", [&](long long i) {
+        from_ntp_bulk(ntp_stamps, shifted, 16);
+        return shifted[i & 15].data;
+    });
+
+    // Boundaries
+    bench.run("boundary/begin_of_the_day", [&](long long i) { return dates[i & mask].begin_of_the_day().data; });
+    bench.run("boundary/begin_of_the_week", [&](long long i) { return dates[i & mask].begin_of_the_week().data; });
+    bench.run("boundary/begin_of_the_month", [&](long long i) { return dates[i & mask].begin_of_the_month().data; });
+    bench.run("boundary/begin_of_the_year", [&](long long i) { return dates[i & mask].begin_of_the_year().data; });
+
+    // Search: 4M sorted events a few seconds apart (32MB), random queries over their span
+    constexpr long long event_count = 1 << 22;
+    constexpr long long query_mask = (1 << 16) - 1;
+    std::vector<datetime> events(event_count);
+    long long event_time = 1700000000000000LL;
+    for (datetime &event : events) event = event_time += static_cast<long long>(rng() % 4000000);
+    std::vector<datetime> queries(query_mask + 1);
+    for (datetime &query : queries) query = events[0].data + static_cast<long long>(rng() % static_cast<unsigned long long>(event_time - events[0].data));
+    const auto earlier = [](datetime a, datetime b) { return a.data < b.data; };
+    time_index event_index(events.data(), event_count);
+    time_index minute_index(events.data(), event_count, 60000000LL);
+    bench.run("index/std_lower_bound", [&](long long i) {
+        return static_cast<long long>(std::lower_bound(events.begin(), events.end(), queries[i & query_mask], earlier) - events.begin());
+    });
+    bench.run("index/time_index", [&](long long i) { return event_index.lower_bound(queries[i & query_mask]); });
+    bench.run("index/time_index_minute_directory", [&](long long i) { return minute_index.lower_bound(queries[i & query_mask]); });
+    // One op is 8 queries
+    long long positions[8];
+    bench.run("index/time_index_bulk_8", [&](long long i) {
+        event_index.lower_bound_bulk(&queries[(i * 8) & query_mask], positions, 8);
+        return positions[i & 7];
+    });
+
+    // Period changes: one op scans 256 consecutive events
+    long long changes[256];
+    bench.run("boundary/different_day_pairs_256", [&](long long i) {
+        const datetime *slice = &events[(i * 256) & (event_count - 1)];
+        long long found = 0;
+        for (int j = 1; j < 256; j++) found += slice[j].different_day(slice[j - 1]);
+        return found;
+    });
+    bench.run("boundary/period_boundaries_day_256", [&](long long i) {
+        return period_boundaries(&events[(i * 256) & (event_count - 1)], 256, calendar_period::day, changes);
+    });
+    bench.run("boundary/different_month_pairs_256", [&](long long i) {
+        const datetime *slice = &events[(i * 256) & (event_count - 1)];
+        long long found = 0;
+        for (int j = 1; j < 256; j++) found += slice[j].different_month(slice[j - 1]);
+        return found;
+    });
+    bench.run("boundary/period_boundaries_month_256", [&](long long i) {
+        return period_boundaries(&events[(i * 256) & (event_count - 1)], 256, calendar_period::month, changes);
+    });
+
+    // As-of join of the sorted queries against the events, one op is 256 queries
+    std::vector<datetime> sorted_queries(queries);
+    std::sort(sorted_queries.begin(), sorted_queries.end(), earlier);
+    long long joined[256];
+    bench.run("join/upper_bound_256", [&](long long i) {
+        const datetime *batch = &sorted_queries[(i * 256) & query_mask];
+        for (int j = 0; j < 256; j++) joined[j] = (std::upper_bound(events.begin(), events.end(), batch[j], earlier) - events.begin()) - 1;
+        return joined[i & 255];
+    });
+    bench.run("join/asof_join_256", [&](long long i) {
+        return asof_join(&sorted_queries[(i * 256) & query_mask], 256, events.data(), event_count, joined);
+    });
+
+    // Intervals: 1M windows of up to 10 minutes starting at the events
+    constexpr long long window_count = 1 << 20;
+    std::vector<datetime_interval> windows(window_count);
+    for (long long w = 0; w < window_count; w++)
+        windows[w] = datetime_interval::half_open(events[w], events[w].data + static_cast<long long>(rng() % 600000000));
+    interval_index window_index(windows.data(), window_count);
+    const long long window_span = windows.back().begin.data - windows[0].begin.data;
+    std::vector<datetime> stabs(query_mask + 1);
+    for (datetime &stab : stabs) stab = windows[0].begin.data + static_cast<long long>(rng() % static_cast<unsigned long long>(window_span));
+    bench.run("interval/stabbing_visit", [&](long long i) {
+        long long found = 0;
+        window_index.overlapping(datetime_interval::closed(stabs[i & query_mask], stabs[i & query_mask]), [&](long long id) { found += id; });
+        return found;
+    });
+    bench.run("interval/stabbing_count", [&](long long i) { return window_index.stabbing_count(stabs[i & query_mask]); });
+
+    // Merge: 1M events dealt round-robin to N sources, one op is 256 merged events
+    for (int source_count : {8, 128, 1024}) {
+        constexpr long long merged_count = 1 << 20;
+        std::vector<std::vector<datetime>> feeds(static_cast<size_t>(source_count));
+        for (long long e = 0; e < merged_count; e++) feeds[static_cast<size_t>(e % source_count)].push_back(events[e]);
+        std::vector<merge_source> sources;
+        for (const auto &feed : feeds) sources.push_back(span_source(feed.data(), static_cast<long long>(feed.size())));
+        std::string name = "merge/loser_tree_" + std::to_string(source_count);
+        time_merger merger(sources.data(), source_count);
+        datetime merged[256];
+        bench.run(name.c_str(), [&](long long) {
+            long long written = merger.next(merged, 256);
+            if (written < 256)
+                merger.reset(sources.data(), source_count);
+            return merged[0].data;
+        });
+        name = "merge/priority_queue_" + std::to_string(source_count);
+        using queued = std::pair<long long, int>; // time, source
+        std::priority_queue<queued, std::vector<queued>, std::greater<queued>> queue;
+        std::vector<size_t> cursors(static_cast<size_t>(source_count));
+        const auto refill_queue = [&] {
+            for (int f = 0; f < source_count; f++) {
+                cursors[static_cast<size_t>(f)] = 1;
+                queue.push({feeds[static_cast<size_t>(f)][0].data, f});
+            }
+        };
+        refill_queue();
+        bench.run(name.c_str(), [&](long long) {
+            long long first = 0;
+            for (int n = 0; n < 256; n++) {
+                if (queue.empty())
+                    refill_queue();
+                const queued top = queue.top();
+                queue.pop();
+                first = n == 0 ? top.first : first;
+                const auto &feed = feeds[static_cast<size_t>(top.second)];
+                size_t &cursor = cursors[static_cast<size_t>(top.second)];
+                if (cursor < feed.size())
+                    queue.push({feed[cursor++].data, top.second});
+            }
+            return first;
+        });
+    }
+
+    // Recurrences
+    recurrence every_quarter_hour, last_business_day;
+    parse_cron("*/15 * * * 1-5", every_quarter_hour);
+    parse_cron("0 17 LW * *", last_business_day);
+    bench.run("recurrence/next_after_quarter_hour_weekdays", [&](long long i) { return every_quarter_hour.next_after(dates[i & mask]).data; });
+    bench.run("recurrence/next_after_last_business_day", [&](long long i) { return last_business_day.next_after(dates[i & mask]).data; });
+    bench.run("recurrence/prev_before_last_business_day", [&](long long i) { return last_business_day.prev_before(dates[i & mask]).data; });
+
+#ifdef __linux__
+    // Series file: 1M events with an 8 byte payload, one op reads the minute after an event through the map
+    {
+        constexpr long long series_count = 1 << 20;
+        const char *series_path = "/tmp/datetime_bench.series";
+        std::remove(series_path);
+        series_writer writer;
+        if (writer.open(series_path)) {
+            for (long long e = 0; e < series_count; e++) writer.append(events[e], &e, sizeof(e));
+            writer.close();
+            series_reader reader;
+            if (reader.open(series_path)) {
+                bench.run("series/range_1_minute", [&](long long i) {
+                    const datetime from = events[(i * 7919) & (series_count - 1)];
+                    long long sum = 0;
+                    reader.range(from, from.data + 60000000LL, [&](datetime, const char *data, unsigned int) { sum += data[0]; });
+                    return sum;
+                });
+            }
+        }
+        std::remove(series_path);
+    }
+#endif
+
+    // Timers: about 1M live timeouts of up to 32s, one op schedules a timer and advances the clock 32µs
+    const bool timers_correct = timer_wheel_fires_rescheduled();
+    if (!timers_correct)
+        std::fprintf(stderr, "timer_wheel left a timer rescheduled from fire unfired\n");
+    {
+        constexpr long long timer_count = 1 << 20;
+        std::vector<long long> timeouts(timer_count);
+        for (long long &timeout : timeouts) timeout = static_cast<long long>(rng() % 32000000);
+        timer_wheel wheel(0LL, 1000);
+        wheel.reserve(2 * timer_count);
+        long long wheel_now = 0;
+        bench.run("timer/wheel_schedule_advance", [&](long long i) {
+            wheel.schedule(wheel_now + timeouts[i & (timer_count - 1)], static_cast<unsigned long long>(i));
+            wheel_now += 32;
+            long long fired = 0;
+            wheel.advance_to(wheel_now, [&](timer_id, unsigned long long payload) { fired += static_cast<long long>(payload); });
+            return fired;
+        });
+        using pending = std::pair<long long, unsigned long long>; // deadline, payload
+        std::priority_queue<pending, std::vector<pending>, std::greater<pending>> heap;
+        long long heap_now = 0;
+        bench.run("timer/priority_queue_schedule_advance", [&](long long i) {
+            heap.push({heap_now + timeouts[i & (timer_count - 1)], static_cast<unsigned long long>(i)});
+            heap_now += 32;
+            long long fired = 0;
+            for (; !heap.empty() && heap.top().first <= heap_now; heap.pop()) fired += static_cast<long long>(heap.top().second);
+            return fired;
+        });
+    }
+
+    // Clock
+    bench.run("now/datetime_now", [](long long) { return datetime::now().data; });
+    bench.run("now/system_clock", [](long long) { return static_cast<long long>(std::chrono::system_clock::now().time_since_epoch().count()); });
+#ifdef DATETIME_BENCH_POSIX
+    bench.run("now/clock_gettime_realtime", [](long long) {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<long long>(ts.tv_nsec);
+    });
+#endif
+    bench.run("now/coarse_now", [](long long) { return coarse_now().data; });
+    if (tsc_clock::start()) {
+        bench.run("now/tsc_clock", [](long long) { return tsc_clock::now().data; });
+        tsc_clock::stop();
+    }
+    shared_clock_publisher publisher;
+    shared_clock_reader reader;
+    if (publisher.open("/gtr_datetime_bench_clock") && reader.open("/gtr_datetime_bench_clock")) {
+        bench.run("now/shared_clock_now", [&](long long) { return reader.now().data; });
+        bench.run("now/shared_clock_snapshot", [&](long long) {
+            shared_clock_snapshot snapshot;
+            reader.read(snapshot);
+            return snapshot.time.data + snapshot.text.length;
+        });
+    }
+
+    return bench.write_json() && timers_correct ? 0 : 1;
+}
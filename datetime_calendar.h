@@ -0,0 +1,312 @@
+#ifndef DATETIME_CALENDAR_H
+#define DATETIME_CALENDAR_H
+#include "datetime.h"
+
+// Calendar kernels working on the day number (days since 1970-01-01) instead of the full civil date.
+// Everything past the day number is 32 bit arithmetic so the bulk loops can be vectorized by the compiler.
+// Civil algorithms adapted from Howard Hinnant's "chrono-Compatible Low-Level Date Algorithms".
+namespace gtr {
+
+constexpr long long DATETIME_MICROSECONDS_PER_DAY = 86400000000LL;
+
+// Whole eras (400 years) added to the day count so every supported day number is positive
+constexpr unsigned int DATETIME_CALENDAR_ERA_BIAS = 1000;
+
+/**
+ * @brief Returns the number of days since epoch, rounding towards the past.
+ */
+constexpr inline int datetime_day_number(long long data) {
+    return static_cast<int>(data / DATETIME_MICROSECONDS_PER_DAY - (data % DATETIME_MICROSECONDS_PER_DAY < 0));
+}
+
+/**
+ * @brief Returns the microsecond of the day, always positive.
+ */
+constexpr inline long long datetime_time_of_day(long long data) {
+    return data - datetime_day_number(data) * DATETIME_MICROSECONDS_PER_DAY;
+}
+
+// Day of the 400 years era, eras starting on March 1st
+constexpr inline unsigned int calendar_day_of_era(int days) {
+    return (static_cast<unsigned int>(days + 719468) + DATETIME_CALENDAR_ERA_BIAS * 146097U) % 146097U;
+}
+
+constexpr inline int calendar_era(int days) {
+    return static_cast<int>((static_cast<unsigned int>(days + 719468) + DATETIME_CALENDAR_ERA_BIAS * 146097U) / 146097U) -
+           static_cast<int>(DATETIME_CALENDAR_ERA_BIAS);
+}
+
+constexpr inline unsigned int calendar_year_of_era(unsigned int day_of_era) {
+    return (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+}
+
+// Day of the year starting on March 1st (0 - 365)
+constexpr inline unsigned int calendar_march_day_of_year(unsigned int day_of_era, unsigned int year_of_era) {
+    return day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+}
+
+/**
+ * @brief Converts a day number to its year, month and day.
+ */
+constexpr inline void civil_from_days(int days, int &year, int &month, int &day) {
+    const unsigned int doe = calendar_day_of_era(days);
+    const unsigned int yoe = calendar_year_of_era(doe);
+    const unsigned int doy = calendar_march_day_of_year(doe, yoe);
+    const unsigned int mp = (5 * doy + 2) / 153;
+    day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    year = static_cast<int>(yoe) + calendar_era(days) * 400 + (month <= 2);
+}
+
+/**
+ * @brief Converts a year, month and day to the number of days since epoch.
+ */
+constexpr inline int days_from_civil(int year, int month, int day) {
+    year -= month <= 2;
+    const unsigned int shifted_year = static_cast<unsigned int>(year) + DATETIME_CALENDAR_ERA_BIAS * 400U;
+    const unsigned int era = shifted_year / 400;
+    const unsigned int yoe = shifted_year - era * 400;
+    const unsigned int mp = static_cast<unsigned int>(month > 2 ? month - 3 : month + 9);
+    const unsigned int doy = (153 * mp + 2) / 5 + static_cast<unsigned int>(day) - 1;
+    const unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (static_cast<int>(era) - static_cast<int>(DATETIME_CALENDAR_ERA_BIAS)) * 146097 + static_cast<int>(doe) - 719468;
+}
+
+/**
+ * @brief Returns the day of the week, 0=Sunday, ...,6=Saturday. 1970-01-01 was a Thursday.
+ */
+constexpr inline int day_of_week_from_days(int days) { return (days % 7 + 11) % 7; }
+
+/**
+ * @brief Returns the year of the day number without computing month and day.
+ */
+constexpr inline int year_from_days(int days) {
+    const unsigned int doe = calendar_day_of_era(days);
+    const unsigned int yoe = calendar_year_of_era(doe);
+    // January and February belong to the next civil year
+    return static_cast<int>(yoe) + calendar_era(days) * 400 + (calendar_march_day_of_year(doe, yoe) >= 306);
+}
+
+/**
+ * @brief Returns the day of the year (1 - 366).
+ */
+constexpr inline int day_of_year_from_days(int days) {
+    const unsigned int doe = calendar_day_of_era(days);
+    const unsigned int yoe = calendar_year_of_era(doe);
+    const unsigned int doy = calendar_march_day_of_year(doe, yoe);
+    // Before January the civil year is the March based year, which is leap when yoe is
+    const unsigned int leap = (yoe % 4 == 0) & ((yoe % 100 != 0) | (yoe == 0));
+    return static_cast<int>(doy >= 306 ? doy - 305 : doy + 60 + leap);
+}
+
+/**
+ * @brief Returns the month (1 - 12).
+ */
+constexpr inline int month_from_days(int days) {
+    const unsigned int doe = calendar_day_of_era(days);
+    const unsigned int mp = (5 * calendar_march_day_of_year(doe, calendar_year_of_era(doe)) + 2) / 153;
+    return static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+}
+
+/**
+ * @brief Returns the quarter of the year (1 - 4).
+ */
+constexpr inline int quarter_from_days(int days) { return (month_from_days(days) + 2) / 3; }
+
+/**
+ * @brief Returns the week of the month (1 - 6), weeks starting on Sunday like begin_of_the_week.
+ */
+constexpr inline int week_of_month_from_days(int days) {
+    int year = 0, month = 0, day = 0;
+    civil_from_days(days, year, month, day);
+    return (day - 1 + day_of_week_from_days(days - day + 1)) / 7 + 1;
+}
+
+// Thursday of the ISO week, which decides the week's year
+constexpr inline int calendar_iso_thursday(int days) { return days - (day_of_week_from_days(days) + 6) % 7 + 3; }
+
+/**
+ * @brief Returns the ISO 8601 week number (1 - 53), weeks starting on Monday.
+ */
+constexpr inline int iso_week_from_days(int days) { return (day_of_year_from_days(calendar_iso_thursday(days)) - 1) / 7 + 1; }
+
+/**
+ * @brief Returns the ISO 8601 week-numbering year, which may differ from the civil year near January 1st.
+ */
+constexpr inline int iso_year_from_days(int days) { return year_from_days(calendar_iso_thursday(days)); }
+
+/**
+ * @brief Returns the number of days of the month (28 - 31).
+ */
+constexpr inline int calendar_month_length(int year, int month) {
+    const int leap = (year % 4 == 0) & ((year % 100 != 0) | (year % 400 == 0));
+    return month == 2 ? 28 + leap : 30 + ((month + (month >> 3)) & 1);
+}
+
+/**
+ * @brief Adds months to a day number, keeping the day of the month.
+ *
+ * A day past the end of the target month is clamped to its last day: January 31st plus one month is February 28th
+ * (29th in a leap year), and the clamp is not remembered, so adding one month twice may differ from adding two.
+ */
+constexpr inline int add_months_to_days(int days, int months) {
+    int year = 0, month = 0, day = 0;
+    civil_from_days(days, year, month, day);
+    // Months since year 0, floored so negative totals land in the previous year
+    const long long total = year * 12LL + (month - 1) + months;
+    const long long total_year = total / 12 - (total % 12 < 0);
+    year = static_cast<int>(total_year);
+    month = static_cast<int>(total - total_year * 12) + 1;
+    const int length = calendar_month_length(year, month);
+    return days_from_civil(year, month, day < length ? day : length);
+}
+
+/**
+ * @brief Adds years to a day number, February 29th becomes February 28th in a common year.
+ */
+constexpr inline int add_years_to_days(int days, int years) {
+    int year = 0, month = 0, day = 0;
+    civil_from_days(days, year, month, day);
+    year += years;
+    const int length = calendar_month_length(year, month);
+    return days_from_civil(year, month, day < length ? day : length);
+}
+
+// The clamping policy of add_months_to_days and add_years_to_days
+static_assert(add_months_to_days(days_from_civil(2023, 1, 31), 1) == days_from_civil(2023, 2, 28), "Jan 31 + 1 month, common year");
+static_assert(add_months_to_days(days_from_civil(2024, 1, 31), 1) == days_from_civil(2024, 2, 29), "Jan 31 + 1 month, leap year");
+static_assert(add_months_to_days(days_from_civil(1900, 1, 31), 1) == days_from_civil(1900, 2, 28), "Jan 31 + 1 month, century");
+static_assert(add_months_to_days(days_from_civil(2000, 1, 31), 1) == days_from_civil(2000, 2, 29), "Jan 31 + 1 month, 400 year");
+static_assert(add_months_to_days(add_months_to_days(days_from_civil(2023, 1, 31), 1), 1) == days_from_civil(2023, 3, 28),
+              "the clamp is not remembered");
+static_assert(add_months_to_days(days_from_civil(2023, 1, 31), 2) == days_from_civil(2023, 3, 31), "Jan 31 + 2 months");
+static_assert(add_months_to_days(days_from_civil(2023, 12, 15), 1) == days_from_civil(2024, 1, 15), "December forward");
+static_assert(add_months_to_days(days_from_civil(2023, 12, 31), 14) == days_from_civil(2025, 2, 28), "December forward over a year");
+static_assert(add_months_to_days(days_from_civil(2020, 12, 31), 38) == days_from_civil(2024, 2, 29), "December forward over years");
+static_assert(add_months_to_days(days_from_civil(1969, 12, 31), 2) == days_from_civil(1970, 2, 28), "December forward over the epoch");
+static_assert(add_months_to_days(days_from_civil(2024, 1, 31), -1) == days_from_civil(2023, 12, 31), "December backward");
+static_assert(add_months_to_days(days_from_civil(2024, 1, 15), -13) == days_from_civil(2022, 12, 15), "December backward over a year");
+static_assert(add_months_to_days(days_from_civil(2024, 3, 31), -25) == days_from_civil(2022, 2, 28), "backward over years, clamped");
+static_assert(add_months_to_days(days_from_civil(1970, 1, 31), -11) == days_from_civil(1969, 2, 28), "backward over the epoch");
+static_assert(add_months_to_days(days_from_civil(2024, 5, 31), -1200) == days_from_civil(1924, 5, 31), "backward a century");
+static_assert(add_months_to_days(days_from_civil(1, 1, 31), -1) == days_from_civil(0, 12, 31), "backward into year 0");
+static_assert(add_months_to_days(days_from_civil(2024, 5, 31), 0) == days_from_civil(2024, 5, 31), "no months");
+static_assert(add_years_to_days(days_from_civil(2024, 2, 29), 1) == days_from_civil(2025, 2, 28), "Feb 29 + 1 year");
+static_assert(add_years_to_days(days_from_civil(2024, 2, 29), 4) == days_from_civil(2028, 2, 29), "Feb 29 + 4 years");
+static_assert(add_years_to_days(days_from_civil(2096, 2, 29), 4) == days_from_civil(2100, 2, 28), "Feb 29 + 4 years, century");
+static_assert(add_years_to_days(days_from_civil(2024, 2, 29), -1) == days_from_civil(2023, 2, 28), "Feb 29 - 1 year");
+static_assert(add_years_to_days(days_from_civil(2023, 12, 31), -54) == days_from_civil(1969, 12, 31), "backward over the epoch");
+
+/**
+ * @brief Adds months to a datetime in microseconds since epoch, the time of day is unchanged.
+ */
+constexpr inline long long datetime_add_months(long long data, int months) {
+    const int days = datetime_day_number(data);
+    return add_months_to_days(days, months) * DATETIME_MICROSECONDS_PER_DAY + (data - days * DATETIME_MICROSECONDS_PER_DAY);
+}
+
+/**
+ * @brief Adds years to a datetime in microseconds since epoch, the time of day is unchanged.
+ */
+constexpr inline long long datetime_add_years(long long data, int years) {
+    const int days = datetime_day_number(data);
+    return add_years_to_days(days, years) * DATETIME_MICROSECONDS_PER_DAY + (data - days * DATETIME_MICROSECONDS_PER_DAY);
+}
+
+/**
+ * @brief The calendar periods a stream of times can be split on, in UTC.
+ */
+enum class calendar_period {
+    minute,
+    hour,
+    day,
+    week,    /**< Weeks starting on Sunday, like begin_of_the_week. */
+    month,
+    quarter,
+    year,
+};
+
+/**
+ * @brief Returns the first microsecond of the period after the one holding data.
+ */
+constexpr inline long long datetime_next_period(long long data, calendar_period period) {
+    const int days = datetime_day_number(data);
+    switch (period) {
+    case calendar_period::minute:
+        return (data / 60000000LL - (data % 60000000LL < 0) + 1) * 60000000LL;
+    case calendar_period::hour:
+        return (data / 3600000000LL - (data % 3600000000LL < 0) + 1) * 3600000000LL;
+    case calendar_period::day:
+        return (days + 1LL) * DATETIME_MICROSECONDS_PER_DAY;
+    case calendar_period::week:
+        return (days + 7LL - day_of_week_from_days(days)) * DATETIME_MICROSECONDS_PER_DAY;
+    case calendar_period::month:
+    case calendar_period::quarter: {
+        int year = 0, month = 0, day = 0;
+        civil_from_days(days, year, month, day);
+        // The month after the period, as a 0 based month of the year
+        month = period == calendar_period::month ? month : (month + 2) / 3 * 3;
+        return days_from_civil(year + month / 12, month % 12 + 1, 1) * DATETIME_MICROSECONDS_PER_DAY;
+    }
+    default:
+        return days_from_civil(year_from_days(days) + 1, 1, 1) * DATETIME_MICROSECONDS_PER_DAY;
+    }
+}
+
+constexpr int DATETIME_CALENDAR_BULK_CHUNK = 256;
+
+// Splits the day numbers into a chunk first so the 32 bit kernel runs on a contiguous array
+template <class Kernel> inline void calendar_bulk(const datetime *dates, int *out, long long count, Kernel kernel) {
+    int days[DATETIME_CALENDAR_BULK_CHUNK];
+    for (long long i = 0; i < count; i += DATETIME_CALENDAR_BULK_CHUNK) {
+        const int size = count - i < DATETIME_CALENDAR_BULK_CHUNK ? static_cast<int>(count - i) : DATETIME_CALENDAR_BULK_CHUNK;
+        for (int j = 0; j < size; j++) days[j] = datetime_day_number(dates[i + j].data);
+        for (int j = 0; j < size; j++) out[i + j] = kernel(days[j]);
+    }
+}
+
+inline void day_of_week_bulk(const datetime *dates, int *out, long long count) {
+    calendar_bulk(dates, out, count, [](int days) { return day_of_week_from_days(days); });
+}
+
+inline void day_of_year_bulk(const datetime *dates, int *out, long long count) {
+    calendar_bulk(dates, out, count, [](int days) { return day_of_year_from_days(days); });
+}
+
+inline void iso_week_bulk(const datetime *dates, int *out, long long count) {
+    calendar_bulk(dates, out, count, [](int days) { return iso_week_from_days(days); });
+}
+
+inline void iso_year_bulk(const datetime *dates, int *out, long long count) {
+    calendar_bulk(dates, out, count, [](int days) { return iso_year_from_days(days); });
+}
+
+inline void quarter_bulk(const datetime *dates, int *out, long long count) {
+    calendar_bulk(dates, out, count, [](int days) { return quarter_from_days(days); });
+}
+
+inline void week_of_month_bulk(const datetime *dates, int *out, long long count) {
+    calendar_bulk(dates, out, count, [](int days) { return week_of_month_from_days(days); });
+}
+/**
+ * @brief Adds the same number of months to every date, out may be dates.
+ */
+inline void add_months_bulk(const datetime *dates, datetime *out, long long count, int months) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_add_months(dates[i].data, months);
+}
+
+/**
+ * @brief Adds months[i] months to dates[i], out may be dates.
+ */
+inline void add_months_bulk(const datetime *dates, const int *months, datetime *out, long long count) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_add_months(dates[i].data, months[i]);
+}
+
+/**
+ * @brief Adds the same number of years to every date, out may be dates.
+ */
+inline void add_years_bulk(const datetime *dates, datetime *out, long long count, int years) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_add_years(dates[i].data, years);
+}
+} // namespace gtr
+#endif
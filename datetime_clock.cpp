@@ -0,0 +1,225 @@
+#include "datetime_clock.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#ifdef __linux__
+#include <time.h>
+#endif
+#ifdef DATETIME_HAS_TSC
+#include <cpuid.h>
+#endif
+namespace gtr {
+
+#ifdef __linux__
+static inline long long timespec_microseconds(const timespec &ts) { return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000; }
+#endif
+
+datetime coarse_now() {
+#ifdef __linux__
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return timespec_microseconds(ts);
+#else
+    return datetime::now();
+#endif
+}
+
+datetime clock_now(clock_mode mode) {
+    switch (mode) {
+    case clock_mode::tsc:
+        return tsc_clock::now();
+    case clock_mode::coarse:
+        return coarse_now();
+    default:
+        return datetime::now();
+    }
+}
+
+#ifdef DATETIME_HAS_TSC
+// A TSC reading paired with CLOCK_REALTIME in nanoseconds
+struct tsc_sample {
+    unsigned long long ticks;
+    long long nanoseconds;
+};
+
+static bool has_invariant_tsc() {
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007)
+        return false;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1U << 8)) != 0;
+}
+
+// Keeps the read of CLOCK_REALTIME bracketed by the fewest ticks, taking their midpoint
+static tsc_sample take_tsc_sample() {
+    tsc_sample best{0, 0};
+    unsigned long long best_span = ~0ULL;
+    for (int i = 0; i < 8; i++) {
+        timespec ts;
+        const unsigned long long before = __rdtsc();
+        clock_gettime(CLOCK_REALTIME, &ts);
+        const unsigned long long after = __rdtsc();
+        if (after - before < best_span) {
+            best_span = after - before;
+            best = {before + (after - before) / 2, ts.tv_sec * 1000000000LL + ts.tv_nsec};
+        }
+    }
+    return best;
+}
+
+static void publish(tsc_clock_state &state, const tsc_sample &anchor, unsigned long long ticks_per_second) {
+    const unsigned int sequence = state.sequence.load(std::memory_order_relaxed);
+    state.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    state.base_ticks.store(anchor.ticks, std::memory_order_relaxed);
+    state.base_time.store(anchor.nanoseconds / 1000, std::memory_order_relaxed);
+    state.multiplier.store((1000000ULL << 32) / ticks_per_second, std::memory_order_relaxed);
+    state.ticks_per_second.store(static_cast<long long>(ticks_per_second), std::memory_order_relaxed);
+    state.sequence.store(sequence + 2, std::memory_order_release);
+}
+
+static unsigned long long ticks_per_second_between(const tsc_sample &from, const tsc_sample &to) {
+    const long long nanoseconds = to.nanoseconds - from.nanoseconds;
+    if (nanoseconds <= 0 || to.ticks <= from.ticks)
+        return 0;
+    return static_cast<unsigned long long>(static_cast<double>(to.ticks - from.ticks) * 1e9 / static_cast<double>(nanoseconds));
+}
+
+// The recalibration thread. start and stop hold control, the thread waits on mutex, and the destructor stops a
+// thread the program left running so it is not destroyed joinable at exit.
+struct tsc_calibration {
+    std::mutex control;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::thread thread;
+    bool stop_requested = false;
+
+    ~tsc_calibration() {
+        std::lock_guard<std::mutex> lock(control);
+        halt();
+    }
+
+    // With control held
+    void halt() {
+        if (!thread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop_requested = true;
+        }
+        wakeup.notify_all();
+        thread.join();
+        tsc_clock_instance.running.store(false, std::memory_order_release);
+    }
+};
+
+static tsc_calibration tsc_calibration_thread;
+
+static void calibration_loop(tsc_sample anchor, int interval_ms) {
+    tsc_clock_state &state = tsc_clock_instance;
+    tsc_calibration &calibration = tsc_calibration_thread;
+    std::unique_lock<std::mutex> lock(calibration.mutex);
+    while (!calibration.wakeup.wait_for(lock, std::chrono::milliseconds(interval_ms), [&] { return calibration.stop_requested; })) {
+        const tsc_sample sample = take_tsc_sample();
+        // What the published conversion gives for the sample's ticks
+        const unsigned long long elapsed = sample.ticks - state.base_ticks.load(std::memory_order_relaxed);
+        const unsigned long long multiplier = state.multiplier.load(std::memory_order_relaxed);
+        const long long predicted = state.base_time.load(std::memory_order_relaxed) +
+                                    static_cast<long long>((elapsed >> 32) * multiplier + (((elapsed & 0xFFFFFFFFULL) * multiplier) >> 32));
+        const unsigned long long ticks_per_second = ticks_per_second_between(anchor, sample);
+        if (ticks_per_second == 0) {
+            // CLOCK_REALTIME stepped backwards, start over from here
+            anchor = sample;
+            continue;
+        }
+        const long long error = (predicted - sample.nanoseconds / 1000) * 1000;
+        state.max_error_ns.store(error < 0 ? -error : error, std::memory_order_relaxed);
+        publish(state, sample, ticks_per_second);
+        anchor = sample;
+    }
+}
+#endif
+
+bool tsc_clock::start(int interval_ms) {
+#ifdef DATETIME_HAS_TSC
+    tsc_calibration &calibration = tsc_calibration_thread;
+    std::lock_guard<std::mutex> control(calibration.control);
+    if (calibration.thread.joinable())
+        return true;
+    if (!has_invariant_tsc())
+        return false;
+    // A first estimate over a short busy period, refined by every recalibration
+    const tsc_sample first = take_tsc_sample();
+    tsc_sample second = take_tsc_sample();
+    while (second.nanoseconds - first.nanoseconds < 20000000LL) second = take_tsc_sample();
+    const unsigned long long ticks_per_second = ticks_per_second_between(first, second);
+    if (ticks_per_second == 0)
+        return false;
+    publish(tsc_clock_instance, second, ticks_per_second);
+    tsc_clock_instance.max_error_ns.store(0, std::memory_order_relaxed);
+    tsc_clock_instance.running.store(true, std::memory_order_release);
+    calibration.stop_requested = false;
+    calibration.thread = std::thread(calibration_loop, second, interval_ms > 0 ? interval_ms : 1);
+    return true;
+#else
+    (void)interval_ms;
+    return false;
+#endif
+}
+
+void tsc_clock::stop() {
+#ifdef DATETIME_HAS_TSC
+    std::lock_guard<std::mutex> control(tsc_calibration_thread.control);
+    tsc_calibration_thread.halt();
+#endif
+}
+
+clock_info tsc_clock::info() { return measure_clock(clock_mode::tsc); }
+
+clock_info measure_clock(clock_mode mode) {
+    clock_info info;
+    info.mode = mode;
+    switch (mode) {
+    case clock_mode::tsc:
+        info.available = tsc_clock::running();
+        info.max_error_ns = tsc_clock_instance.max_error_ns.load(std::memory_order_relaxed);
+        info.ticks_per_second = tsc_clock_instance.ticks_per_second.load(std::memory_order_relaxed);
+        break;
+    case clock_mode::coarse:
+#ifdef __linux__
+        info.available = true;
+#endif
+        break;
+    default:
+        info.available = true;
+        break;
+    }
+
+    // Cost: a batch of back to back reads
+    constexpr int reads = 100000;
+    volatile long long sink = 0;
+    const auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < reads; i++) sink = clock_now(mode).data;
+    const auto elapsed = std::chrono::steady_clock::now() - begin;
+    (void)sink;
+    info.cost_ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / reads;
+
+    // Resolution: the smallest step seen over a few changes of the value, bounded to 50ms
+    long long resolution = 0;
+    int changes = 0;
+    long long previous = clock_now(mode).data;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+    while (changes < 16 && std::chrono::steady_clock::now() < deadline) {
+        const long long current = clock_now(mode).data;
+        if (current != previous) {
+            const long long step = current > previous ? current - previous : previous - current;
+            if (changes++ == 0 || step < resolution)
+                resolution = step;
+            previous = current;
+        }
+    }
+    info.resolution_ns = resolution * 1000;
+    return info;
+}
+} // namespace gtr
@@ -0,0 +1,116 @@
+#ifndef DATETIME_CLOCK_H
+#define DATETIME_CLOCK_H
+#include "datetime.h"
+#include <atomic>
+#if defined(__linux__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define DATETIME_HAS_TSC
+#endif
+
+// Clocks cheaper than datetime::now(): the invariant TSC calibrated against CLOCK_REALTIME by a background thread,
+// and CLOCK_REALTIME_COARSE. Where they are not available both fall back to datetime::now().
+namespace gtr {
+
+/**
+ * @brief The clocks a call site can choose from.
+ */
+enum class clock_mode {
+    system, /**< datetime::now(), std::chrono::system_clock. */
+    tsc,    /**< The invariant TSC scaled to microseconds, see tsc_clock. */
+    coarse, /**< CLOCK_REALTIME_COARSE, updated once per kernel tick. */
+};
+
+/**
+ * @brief Measured properties of a clock.
+ */
+struct clock_info {
+    clock_mode mode{clock_mode::system};
+    bool available{false};          /**< False when the mode falls back to datetime::now(). */
+    double cost_ns{0};              /**< Average cost of one read. */
+    long long resolution_ns{0};     /**< Smallest step between two different reads. */
+    long long max_error_ns{0};      /**< TSC only: the offset from CLOCK_REALTIME found by the last calibration. */
+    long long ticks_per_second{0};  /**< TSC only: the calibrated frequency. */
+};
+
+// Conversion published by the calibration thread under a sequence lock: odd while being written
+struct tsc_clock_state {
+    std::atomic<unsigned int> sequence{0};
+    std::atomic<unsigned long long> base_ticks{0};
+    std::atomic<long long> base_time{0};            // microseconds since epoch at base_ticks
+    std::atomic<unsigned long long> multiplier{0};  // microseconds per tick, 32.32 fixed point
+    std::atomic<bool> running{false};
+    std::atomic<long long> max_error_ns{0};
+    std::atomic<long long> ticks_per_second{0};
+};
+
+inline tsc_clock_state tsc_clock_instance;
+
+/**
+ * Reads the invariant TSC and converts it with the latest calibration.
+ *
+ * start() checks the CPU has an invariant TSC, calibrates it against CLOCK_REALTIME and starts a thread that
+ * recalibrates every interval, so the error stays bounded by the TSC drift over one interval (reported by
+ * info().max_error_ns). A recalibration may step the clock by that error, backwards included.
+ * Until started, or where there is no invariant TSC, now() is datetime::now().
+ */
+struct tsc_clock {
+    /**
+     * @brief Calibrates and starts the background recalibration.
+     * @param interval_ms Milliseconds between calibrations.
+     * @return False if there is no invariant TSC, now() then keeps using datetime::now().
+     */
+    static bool start(int interval_ms = 1000);
+
+    /**
+     * @brief Stops the background recalibration, now() goes back to datetime::now().
+     *
+     * A recalibration still running when the program exits is stopped then.
+     */
+    static void stop();
+
+    static inline bool running() { return tsc_clock_instance.running.load(std::memory_order_relaxed); }
+
+    static inline datetime now() {
+#ifdef DATETIME_HAS_TSC
+        tsc_clock_state &state = tsc_clock_instance;
+        if (state.running.load(std::memory_order_relaxed)) {
+            for (;;) {
+                const unsigned int before = state.sequence.load(std::memory_order_acquire);
+                const unsigned long long base_ticks = state.base_ticks.load(std::memory_order_relaxed);
+                const long long base_time = state.base_time.load(std::memory_order_relaxed);
+                const unsigned long long multiplier = state.multiplier.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if ((before & 1) == 0 && state.sequence.load(std::memory_order_relaxed) == before) {
+                    // Split so the product cannot overflow however long since the last calibration
+                    const unsigned long long elapsed = __rdtsc() - base_ticks;
+                    const unsigned long long micros = (elapsed >> 32) * multiplier + (((elapsed & 0xFFFFFFFFULL) * multiplier) >> 32);
+                    return base_time + static_cast<long long>(micros);
+                }
+            }
+        }
+#endif
+        return datetime::now();
+    }
+
+    /**
+     * @brief Measures the cost and resolution of now() and reports the calibration.
+     */
+    static clock_info info();
+};
+
+/**
+ * @brief Reads CLOCK_REALTIME_COARSE, a few nanoseconds but only as fresh as the last kernel tick (typically 1 - 4ms).
+ */
+datetime coarse_now();
+
+/**
+ * @brief Reads the clock of the mode.
+ */
+datetime clock_now(clock_mode mode);
+
+/**
+ * @brief Measures the cost and resolution of a clock, taking a few milliseconds.
+ */
+clock_info measure_clock(clock_mode mode);
+} // namespace gtr
+#endif
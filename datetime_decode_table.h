@@ -0,0 +1,89 @@
+#ifndef DATETIME_DECODE_TABLE_H
+#define DATETIME_DECODE_TABLE_H
+#include "datetime_calendar.h"
+
+// Precomputed year, month, day and day of week for every day of a range of years, so decoding
+// a date inside the range is a single load. The table is built at compile time (about 190KB for 1970 - 2100).
+#ifndef DATETIME_DECODE_TABLE_FIRST_YEAR
+#define DATETIME_DECODE_TABLE_FIRST_YEAR 1970
+#endif
+#ifndef DATETIME_DECODE_TABLE_LAST_YEAR
+#define DATETIME_DECODE_TABLE_LAST_YEAR 2100
+#endif
+
+namespace gtr {
+
+/**
+ * @brief A day of the decode table packed in 32 bits.
+ * Bits 0-4 day, 5-8 month, 9-11 day of week, 12-31 year.
+ */
+struct datetime_decode_entry {
+    unsigned int packed;
+
+    inline constexpr int day() const { return static_cast<int>(packed & 0x1F); }
+    inline constexpr int month() const { return static_cast<int>((packed >> 5) & 0xF); }
+    inline constexpr int day_of_week() const { return static_cast<int>((packed >> 9) & 0x7); }
+    inline constexpr int year() const { return static_cast<int>(packed) >> 12; }
+};
+
+struct datetime_decode_table {
+    static constexpr int first_year = DATETIME_DECODE_TABLE_FIRST_YEAR;
+    static constexpr int last_year = DATETIME_DECODE_TABLE_LAST_YEAR;
+    static constexpr int first_day = days_from_civil(first_year, 1, 1);
+    static constexpr int size = days_from_civil(last_year + 1, 1, 1) - first_day;
+
+    datetime_decode_entry entries[size];
+
+    constexpr datetime_decode_table() : entries{} {
+        constexpr int month_days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        int index = 0;
+        int dow = day_of_week_from_days(first_day);
+        // Nested so no single loop hits the compiler's constexpr iteration limit
+        for (int year = first_year; year <= last_year; year++) {
+            const bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+            for (int month = 1; month <= 12; month++) {
+                const int count = month_days[month - 1] + (month == 2 && leap);
+                for (int day = 1; day <= count; day++) {
+                    entries[index++].packed = static_cast<unsigned int>(year) << 12 | static_cast<unsigned int>(dow) << 9 |
+                                              static_cast<unsigned int>(month) << 5 | static_cast<unsigned int>(day);
+                    dow = dow == 6 ? 0 : dow + 1;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the entry of the day number, or nullptr when it is outside the table.
+     */
+    inline constexpr const datetime_decode_entry *find(int days) const {
+        const unsigned int index = static_cast<unsigned int>(days - first_day);
+        return index < static_cast<unsigned int>(size) ? &entries[index] : nullptr;
+    }
+};
+
+static_assert(DATETIME_DECODE_TABLE_FIRST_YEAR <= DATETIME_DECODE_TABLE_LAST_YEAR, "empty decode table range");
+
+inline constexpr datetime_decode_table datetime_decode_table_instance{};
+
+/**
+ * @brief Decodes the datetime through the table.
+ * @return False if the date is outside the table, leaving pack untouched.
+ */
+inline bool datetime_decode_table_pack(long long data, datetime_struct &pack) {
+    const int days = datetime_day_number(data);
+    const datetime_decode_entry *entry = datetime_decode_table_instance.find(days);
+    if (entry == nullptr)
+        return false;
+    const long long time_of_day = data - days * DATETIME_MICROSECONDS_PER_DAY;
+    const int seconds = static_cast<int>(time_of_day / 1000000LL);
+    pack.microsecond = static_cast<unsigned int>(time_of_day % 1000000LL);
+    pack.year = entry->year();
+    pack.month = entry->month();
+    pack.day = entry->day();
+    pack.hour = seconds / 3600;
+    pack.minute = seconds % 3600 / 60;
+    pack.second = seconds % 60;
+    return true;
+}
+} // namespace gtr
+#endif
@@ -0,0 +1,563 @@
+#ifndef DATETIME_DETECT_H
+#define DATETIME_DETECT_H
+#include "datetime_iso8601.h"
+#include "datetime_parser.h"
+
+// Format strings compiled once into steps, a parser over several formats that dispatches on the
+// length and digit positions of the input, and inference of a format string from sample lines.
+namespace gtr {
+
+/**
+ * @brief The longest format string a compiled_format holds, not counting the terminator.
+ */
+constexpr int DATETIME_COMPILED_FORMAT_CAPACITY = 63;
+
+/**
+ * @brief Fixed layouts up to this length are matched by a digit position mask.
+ */
+constexpr int DATETIME_SIGNATURE_LENGTH = 64;
+
+enum class format_op : unsigned char {
+    year_four,
+    year_two,
+    year_all,
+    month_digits,
+    month_abbrev,
+    month_name,
+    day,
+    weekday_abbrev,
+    weekday_name,
+    hour,
+    minute,
+    second,
+    fraction,
+    literal,
+};
+
+struct format_step {
+    format_op op;
+    char literal;          // the expected character of a literal step
+    unsigned char width;   // the width in a fixed layout, 0 when it varies
+    unsigned char offset;  // the byte offset in a fixed layout
+};
+
+/**
+ * Returns a mask with bit i set when text[i] is an ASCII digit, for the first DATETIME_SIGNATURE_LENGTH bytes.
+ * Computed a word at a time, the digit flags of a word are gathered into 8 bits with a multiply.
+ */
+inline unsigned long long datetime_digit_mask(const char *text, int length) {
+    const int size = length < DATETIME_SIGNATURE_LENGTH ? length : DATETIME_SIGNATURE_LENGTH;
+    unsigned long long mask = 0;
+    int offset = 0;
+    for (; offset + 8 <= size; offset += 8) {
+        const unsigned long long flags = datetime_swar_digit_flags(datetime_swar_load(text + offset)) >> 7;
+        mask |= ((flags * 0x0102040810204080ULL) >> 56) << offset;
+    }
+    if (offset < size) {
+        // Zero padded so nothing past the input is read
+        char tail[8] = {};
+        for (int i = 0; i < size - offset; i++) tail[i] = text[offset + i];
+        const unsigned long long flags = datetime_swar_digit_flags(datetime_swar_load(tail)) >> 7;
+        mask |= ((flags * 0x0102040810204080ULL) >> 56) << offset;
+    }
+    return mask;
+}
+
+/**
+ * @brief A format string tokenized once, so parsing does not re-scan the format.
+ *
+ * Accepts the same grammar as datetime::from_string_safe. Formats whose fields all have a fixed width also get a
+ * signature, the total length and the positions of the digits, which is checked a word at a time before the fields
+ * are converted without further per character checks.
+ */
+struct compiled_format {
+    char format[DATETIME_COMPILED_FORMAT_CAPACITY + 1]{};
+    date_format group{date_format::text_date};
+    format_step steps[DATETIME_COMPILED_FORMAT_CAPACITY]{};
+    int step_count{0};
+    int fixed_length{-1};           /**< The input length of a fixed layout, -1 when a field has a variable width. */
+    unsigned long long digit_mask{0}; /**< Digit positions of a fixed layout. */
+
+    /**
+     * @brief Tokenizes the format.
+     * @return False if the format is longer than DATETIME_COMPILED_FORMAT_CAPACITY.
+     */
+    bool compile(const char *source, date_format group_format = date_format::text_date) {
+        *this = compiled_format{};
+        group = group_format;
+        int length = 0;
+        while (source[length] != '\0') {
+            if (length == DATETIME_COMPILED_FORMAT_CAPACITY)
+                return false;
+            format[length] = source[length];
+            length++;
+        }
+        if (group == date_format::iso_date)
+            return true;
+
+        // Mirrors the tokens of parse_datetime_string_safe
+        const char *state = format;
+        bool fixed = true;
+        int offset = 0;
+        while (*state != '\0') {
+            format_step step{format_op::literal, '\0', 0, 0};
+            int width = 0;
+            switch (*state) {
+            case 'M':
+                if (state[1] == 'M' && state[2] == 'M' && state[3] == 'M') {
+                    step.op = format_op::month_name;
+                    state += 4;
+                } else if (state[1] == 'M' && state[2] == 'M') {
+                    step.op = format_op::month_abbrev;
+                    width = 3;
+                    state += 3;
+                } else {
+                    step.op = format_op::month_digits;
+                    width = 2;
+                    state += state[1] != '\0' ? 2 : 1;
+                }
+                break;
+            case 'd':
+                if (state[1] == 'd' && state[2] == 'd' && state[3] == 'd') {
+                    step.op = format_op::weekday_name;
+                    state += 4;
+                } else if (state[1] == 'd' && state[2] == 'd') {
+                    step.op = format_op::weekday_abbrev;
+                    width = 3;
+                    state += 3;
+                } else {
+                    step.literal = *state++;
+                    width = 1;
+                }
+                break;
+            case 'Y': {
+                int count = 0;
+                while (state[count] == 'Y') count++;
+                if (count == 4) {
+                    step.op = format_op::year_four;
+                    width = 4;
+                } else if (count == 2) {
+                    step.op = format_op::year_two;
+                    width = 2;
+                } else {
+                    step.op = format_op::year_all;
+                    if (count == 1 && state[1] == 'F')
+                        count++;
+                }
+                state += count;
+                break;
+            }
+            case 'D':
+            case 'h':
+            case 'm':
+            case 's':
+                step.op = *state == 'D' ? format_op::day : *state == 'h' ? format_op::hour : *state == 'm' ? format_op::minute : format_op::second;
+                width = 2;
+                state += state[1] != '\0' ? 2 : 1;
+                break;
+            case 'z':
+                step.op = format_op::fraction;
+                while (*state == 'z') {
+                    width++;
+                    state++;
+                }
+                // The checked parse reads one to six digits, only widths it accepts form a fixed layout
+                if (width > 6)
+                    width = 0;
+                break;
+            default:
+                step.literal = *state++;
+                width = 1;
+                break;
+            }
+            fixed &= width > 0;
+            if (fixed) {
+                step.width = static_cast<unsigned char>(width);
+                step.offset = static_cast<unsigned char>(offset);
+                const bool digits = step.op == format_op::literal ? is_numeric(step.literal)
+                                                                  : step.op != format_op::month_abbrev && step.op != format_op::weekday_abbrev;
+                if (digits)
+                    digit_mask |= ((1ULL << width) - 1) << offset;
+                offset += width;
+                fixed = offset <= DATETIME_SIGNATURE_LENGTH;
+            }
+            steps[step_count++] = step;
+        }
+        fixed_length = fixed ? offset : -1;
+        if (!fixed)
+            digit_mask = 0;
+        return true;
+    }
+
+    /**
+     * @brief Parses a length bounded, untrusted string like datetime::from_string_safe.
+     */
+    parse_result parse(const char *text, int length, datetime &out) const {
+        return parse(text, length, fixed_length == length ? datetime_digit_mask(text, length) : 0, out);
+    }
+
+    // Parses with the digit mask of the input already computed
+    parse_result parse(const char *text, int length, unsigned long long input_mask, datetime &out) const {
+        if (group == date_format::iso_date)
+            return parse_iso8601(text, length, out);
+        datetime_struct pack = make_checked_pack();
+        if (length == fixed_length && input_mask == digit_mask && parse_fixed_layout(text, pack)) {
+            out = datetime(pack.day, pack.month, pack.year, pack.hour, pack.minute, pack.second, static_cast<int>(pack.microsecond));
+            return {};
+        }
+        pack = make_checked_pack();
+        parse_cursor cursor = make_parse_cursor(text, length);
+        for (int i = 0; i < step_count; i++) {
+            if (!parse_step(steps[i], cursor, pack)) {
+                out = DATETIME_INVALID;
+                return cursor.result;
+            }
+        }
+        if (!parse_checked_finish(cursor, pack)) {
+            out = DATETIME_INVALID;
+            return cursor.result;
+        }
+        out = datetime(pack.day, pack.month, pack.year, pack.hour, pack.minute, pack.second, static_cast<int>(pack.microsecond));
+        return {};
+    }
+
+  private:
+    bool parse_fixed_layout(const char *text, datetime_struct &pack) const {
+        bool valid = true;
+        for (int i = 0; i < step_count; i++) {
+            const format_step &step = steps[i];
+            const char *field = text + step.offset;
+            switch (step.op) {
+            case format_op::year_four:
+                valid &= year_field<year_four>::parse_fixed(field, pack);
+                break;
+            case format_op::year_two:
+                valid &= year_field<year_two>::parse_fixed(field, pack);
+                break;
+            case format_op::month_digits:
+                valid &= month_field<>::parse_fixed(field, pack);
+                break;
+            case format_op::month_abbrev:
+                valid &= month_field<month_format::month_abbrev>::parse_fixed(field, pack);
+                break;
+            case format_op::day:
+                valid &= day_field::parse_fixed(field, pack);
+                break;
+            case format_op::weekday_abbrev:
+                valid &= weekday_field<>::parse_fixed(field, pack);
+                break;
+            case format_op::hour:
+                valid &= hour_field::parse_fixed(field, pack);
+                break;
+            case format_op::minute:
+                valid &= minute_field::parse_fixed(field, pack);
+                break;
+            case format_op::second:
+                valid &= second_field::parse_fixed(field, pack);
+                break;
+            case format_op::fraction: {
+                int value = 0;
+                for (int d = 0; d < step.width; d++) value = value * 10 + (field[d] - '0');
+                pack.microsecond = value * pow10_table[6 - step.width];
+                break;
+            }
+            case format_op::literal:
+                valid &= *field == step.literal;
+                break;
+            default:
+                return false;
+            }
+        }
+        return valid && datetime_pack_in_range(pack);
+    }
+
+    static bool parse_step(const format_step &step, parse_cursor &cursor, datetime_struct &pack) {
+        switch (step.op) {
+        case format_op::year_four:
+            return year_field<year_four>::parse_checked(cursor, pack);
+        case format_op::year_two:
+            return year_field<year_two>::parse_checked(cursor, pack);
+        case format_op::year_all:
+            return year_field<year_all>::parse_checked(cursor, pack);
+        case format_op::month_digits:
+            return month_field<>::parse_checked(cursor, pack);
+        case format_op::month_abbrev:
+            return month_field<month_format::month_abbrev>::parse_checked(cursor, pack);
+        case format_op::month_name:
+            return month_field<month_format::month_name>::parse_checked(cursor, pack);
+        case format_op::day:
+            return day_field::parse_checked(cursor, pack);
+        case format_op::weekday_abbrev:
+            return weekday_field<>::parse_checked(cursor, pack);
+        case format_op::weekday_name:
+            return weekday_field<weekday_format::weekday_name>::parse_checked(cursor, pack);
+        case format_op::hour:
+            return hour_field::parse_checked(cursor, pack);
+        case format_op::minute:
+            return minute_field::parse_checked(cursor, pack);
+        case format_op::second:
+            return second_field::parse_checked(cursor, pack);
+        case format_op::fraction:
+            return microsecond_field<>::parse_checked(cursor, pack);
+        case format_op::literal:
+            if (cursor.current == cursor.end)
+                return cursor.fail(parse_error::unexpected_end, cursor.current);
+            if (*cursor.current != step.literal)
+                return cursor.fail(parse_error::expected_separator, cursor.current);
+            cursor.current++;
+            return true;
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief The number of formats a multi_format_parser holds.
+ */
+constexpr int DATETIME_MULTI_FORMAT_CAPACITY = 16;
+
+/**
+ * Parses inputs that may be in any of several formats.
+ *
+ * The input's length and digit positions are compared against the signature of every fixed layout, so only formats
+ * with the same shape are tried, and formats with variable width fields are tried after them. The format that
+ * parsed the previous input is tried first, which makes a run of inputs in the same format cost about one parse.
+ * Formats with the same signature, like DD/MM/YYYY and MM/DD/YYYY, are tried in the order they were added.
+ */
+struct multi_format_parser {
+    compiled_format formats[DATETIME_MULTI_FORMAT_CAPACITY];
+    int count{0};
+    int last{-1}; /**< The format that parsed the previous input, -1 before the first success. */
+
+    /**
+     * @brief Adds a format.
+     * @return False if the parser is full or the format is too long.
+     */
+    bool add(const char *format, date_format group_format = date_format::text_date) {
+        if (count == DATETIME_MULTI_FORMAT_CAPACITY || !formats[count].compile(format, group_format))
+            return false;
+        count++;
+        return true;
+    }
+
+    /**
+     * @brief Returns the index of the format with the same format string and group, or -1.
+     */
+    int find(const char *format, date_format group_format = date_format::text_date) const {
+        for (int i = 0; i < count; i++) {
+            int c = 0;
+            while (format[c] != '\0' && format[c] == formats[i].format[c]) c++;
+            if (format[c] == formats[i].format[c] && formats[i].group == group_format)
+                return i;
+        }
+        return -1;
+    }
+
+    /**
+     * Parses a length bounded, untrusted string with the first format that accepts it.
+     *
+     * @param matched Set to the index of the format used, or -1 if none accepted the input.
+     * @return The result of the last format tried, expected_separator when no format has the input's shape.
+     */
+    parse_result parse(const char *text, int length, datetime &out, int *matched = nullptr) {
+        const unsigned long long mask = datetime_digit_mask(text, length);
+        parse_result result{parse_error::expected_separator, 0};
+        if (last >= 0 && accepts(formats[last], length, mask)) {
+            result = formats[last].parse(text, length, mask, out);
+            if (result)
+                return found(last, matched);
+        }
+        // Matching fixed layouts first, they are rejected by a compare
+        for (int i = 0; i < count; i++) {
+            if (i != last && formats[i].fixed_length == length && formats[i].digit_mask == mask) {
+                result = formats[i].parse(text, length, mask, out);
+                if (result)
+                    return found(i, matched);
+            }
+        }
+        for (int i = 0; i < count; i++) {
+            if (i != last && formats[i].fixed_length < 0) {
+                result = formats[i].parse(text, length, mask, out);
+                if (result)
+                    return found(i, matched);
+            }
+        }
+        out = DATETIME_INVALID;
+        if (matched != nullptr)
+            *matched = -1;
+        return result;
+    }
+
+  private:
+    static bool accepts(const compiled_format &format, int length, unsigned long long mask) {
+        return format.fixed_length < 0 || (format.fixed_length == length && format.digit_mask == mask);
+    }
+
+    parse_result found(int index, int *matched) {
+        last = index;
+        if (matched != nullptr)
+            *matched = index;
+        return {};
+    }
+};
+
+// True when a literal character can be written in a format string without being read as a token
+inline bool datetime_format_literal(char c) {
+    return c != 'Y' && c != 'M' && c != 'D' && c != 'h' && c != 'm' && c != 's' && c != 'z' && c != 'd' && c != '\0';
+}
+
+inline bool datetime_format_append(char *format, int &size, const char *text, int count) {
+    if (size + count > DATETIME_COMPILED_FORMAT_CAPACITY)
+        return false;
+    for (int i = 0; i < count; i++) format[size++] = text[i];
+    return true;
+}
+
+/**
+ * Infers a format string of this library's grammar from one input, e.g. "Mon, 10 Jun 2024 12:34:56.250" gives
+ * "ddd, DD MMM YYYY hh:mm:ss.zzz".
+ *
+ * Recognizes four digit years, two digit months, days, hours, minutes and seconds, fractions after the seconds,
+ * month and weekday names, and YYYYMMDD or YYYYMMDDhhmmss digit runs. Two digit fields before the year are read as
+ * day then month when day_first is set, month then day otherwise; after the year as month then day.
+ * ISO 8601 inputs with an offset are given as date_format::iso_date with an empty format.
+ *
+ * @param text The input, does not need to be null terminated.
+ * @param length The number of characters of text.
+ * @param format The inferred format, at least DATETIME_COMPILED_FORMAT_CAPACITY + 1 characters.
+ * @param group Set to the group of the inferred format.
+ * @param day_first The order of ambiguous day and month fields.
+ * @return False if no format of the grammar fits the input.
+ */
+inline bool infer_format(const char *text, int length, char *format, date_format &group, bool day_first = true) {
+    int size = 0;
+    group = date_format::text_date;
+    int date_fields[2]{};     // positions in format of two digit fields before the time
+    int date_field_count = 0;
+    int year_position = -1;
+    bool has_month_name = false;
+    bool date_complete = false; // a YYYYMMDD run
+    int time_fields = 0;      // hour, minute and second found
+    bool fraction = false;
+    bool ok = true;
+
+    for (int i = 0; ok && i < length;) {
+        const char c = text[i];
+        int run = 0;
+        if (is_numeric(c)) {
+            while (i + run < length && is_numeric(text[i + run])) run++;
+            const char before = i > 0 ? text[i - 1] : '\0';
+            const char after = i + run < length ? text[i + run] : '\0';
+            if (time_fields == 3 && !fraction && (before == '.' || before == ',') && run <= 6) {
+                for (int z = 0; z < run && ok; z++) ok = datetime_format_append(format, size, "z", 1);
+                fraction = true;
+            } else if (run == 2 && time_fields < 3 && (after == ':' || (before == ':' && time_fields > 0))) {
+                ok = datetime_format_append(format, size, time_fields == 0 ? "hh" : time_fields == 1 ? "mm" : "ss", 2);
+                time_fields++;
+            } else if (time_fields == 0 && year_position < 0 && date_field_count == 0 && (run == 8 || run == 14)) {
+                ok = datetime_format_append(format, size, run == 8 ? "YYYYMMDD" : "YYYYMMDDhhmmss", run);
+                year_position = size - run;
+                date_complete = true;
+                time_fields = run == 14 ? 3 : 0;
+            } else if (time_fields == 0 && run == 4 && year_position < 0) {
+                year_position = size;
+                ok = datetime_format_append(format, size, "YYYY", 4);
+            } else if (time_fields == 0 && run == 2 && date_field_count < 2) {
+                date_fields[date_field_count++] = size;
+                ok = datetime_format_append(format, size, "??", 2);
+            } else {
+                ok = false;
+            }
+        } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') {
+            while (i + run < length && ((text[i + run] | 0x20) >= 'a' && (text[i + run] | 0x20) <= 'z')) run++;
+            const char *end = text + length;
+            const int month = run >= 3 ? datetime_month_from_name(text + i) : 0;
+            const int weekday = run >= 3 ? datetime_weekday_from_name(text + i) : -1;
+            if (month != 0 && !has_month_name && !date_complete && (run == 3 || (run == datetime_month_name_table.names[month - 1].length &&
+                                                               datetime_name_matches(text + i, end, datetime_month_name_table.names[month - 1])))) {
+                ok = datetime_format_append(format, size, run == 3 ? "MMM" : "MMMM", run == 3 ? 3 : 4);
+                has_month_name = true;
+            } else if (weekday >= 0 && (run == 3 || (run == datetime_weekday_name_table.names[weekday].length &&
+                                                     datetime_name_matches(text + i, end, datetime_weekday_name_table.names[weekday])))) {
+                ok = datetime_format_append(format, size, run == 3 ? "ddd" : "dddd", run == 3 ? 3 : 4);
+            } else {
+                for (int l = 0; l < run && ok; l++) ok = datetime_format_literal(text[i + l]) && datetime_format_append(format, size, text + i + l, 1);
+            }
+        } else {
+            run = 1;
+            ok = (c == '+' || c == '-') && time_fields > 0 ? false : datetime_format_literal(c) && datetime_format_append(format, size, &c, 1);
+            // An offset after the time is only expressible as ISO 8601
+            if (!ok && time_fields > 0 && year_position >= 0) {
+                datetime parsed;
+                if (parse_iso8601(text, length, parsed)) {
+                    group = date_format::iso_date;
+                    format[0] = '\0';
+                    return true;
+                }
+            }
+        }
+        i += run;
+    }
+    if (!ok || year_position < 0 || (time_fields != 0 && time_fields < 2))
+        return false;
+
+    // Resolve the two digit date fields
+    const int needed = date_complete ? 0 : has_month_name ? 1 : 2;
+    if (date_field_count != needed)
+        return false;
+    if (needed == 1) {
+        format[date_fields[0]] = format[date_fields[0] + 1] = 'D';
+    } else if (needed == 2) {
+        const bool year_first = year_position < date_fields[0];
+        const bool day_in_first = !year_first && day_first;
+        format[date_fields[0]] = format[date_fields[0] + 1] = day_in_first ? 'D' : 'M';
+        format[date_fields[1]] = format[date_fields[1] + 1] = day_in_first ? 'M' : 'D';
+    }
+    format[size] = '\0';
+    return true;
+}
+
+/**
+ * Infers the formats of sample lines and adds them to the parser, one format per distinct shape.
+ *
+ * Every sample not parsed by the formats found so far gets a format inferred from it. When its day and month order is
+ * ambiguous both orders are tried on all samples and the one parsing more of them is kept, day first on a tie.
+ *
+ * @return The number of samples the parser accepts afterwards.
+ */
+inline int detect_formats(const char *const *lines, const int *lengths, int count, multi_format_parser &parser) {
+    const auto accepted = [&](const compiled_format &format) {
+        int parsed = 0;
+        datetime out;
+        for (int i = 0; i < count; i++) parsed += static_cast<bool>(format.parse(lines[i], lengths[i], out));
+        return parsed;
+    };
+    int parsed = 0;
+    for (int i = 0; i < count; i++) {
+        datetime out;
+        if (parser.parse(lines[i], lengths[i], out)) {
+            parsed++;
+            continue;
+        }
+        char day_first[DATETIME_COMPILED_FORMAT_CAPACITY + 1];
+        char month_first[DATETIME_COMPILED_FORMAT_CAPACITY + 1];
+        date_format group = date_format::text_date;
+        if (!infer_format(lines[i], lengths[i], day_first, group, true))
+            continue;
+        infer_format(lines[i], lengths[i], month_first, group, false);
+        const char *best = day_first;
+        if (parser.find(day_first, group) < 0 && parser.find(month_first, group) < 0) {
+            compiled_format first, second;
+            first.compile(day_first, group);
+            second.compile(month_first, group);
+            if (accepted(second) > accepted(first))
+                best = month_first;
+        }
+        if (parser.find(best, group) < 0 && !parser.add(best, group))
+            break;
+        parsed += static_cast<bool>(parser.parse(lines[i], lengths[i], out));
+    }
+    return parsed;
+}
+} // namespace gtr
+#endif
@@ -0,0 +1,269 @@
+#ifndef DATETIME_EPOCH_H
+#define DATETIME_EPOCH_H
+#include "datetime_parser.h"
+
+// Unix timestamps written as decimal text, e.g. "1718049600", "1718049600123456" or "1718049600.123".
+// Digits are converted 8 at a time with SWAR arithmetic on 64 bit words.
+namespace gtr {
+
+/**
+ * @brief The unit of a numeric epoch string.
+ */
+enum class epoch_unit {
+    autodetect,   /**< Picked from the number of integer digits: up to 10 seconds, 13 milliseconds, 16 microseconds, 19 nanoseconds. */
+    seconds,      /**< Seconds since epoch. */
+    milliseconds, /**< Milliseconds since epoch. */
+    microseconds, /**< Microseconds since epoch, the datetime resolution. */
+    nanoseconds,  /**< Nanoseconds since epoch, truncated to microseconds. */
+};
+
+/**
+ * @brief The maximum length of a string written by format_epoch, not counting the terminator.
+ */
+constexpr int DATETIME_EPOCH_CAPACITY = 24;
+
+// Microseconds in one unit, nanoseconds divide instead
+constexpr long long epoch_unit_microseconds[] = {1000000LL, 1000000LL, 1000LL, 1LL, 1LL};
+
+constexpr unsigned long long epoch_pow10[] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL};
+
+constexpr unsigned long long DATETIME_EPOCH_MAX_MAGNITUDE = 9223372036854775807ULL;
+
+// Number of leading bytes of the word flagged as digits by datetime_swar_digit_flags
+inline int datetime_swar_digit_run(unsigned long long flags) {
+    const unsigned long long stop = ~flags & 0x8080808080808080ULL;
+    if (stop == 0)
+        return 8;
+    return datetime_count_trailing_zeros(stop) / 8;
+}
+
+// Reads a run of up to 19 digits, a word at a time. A partial run is shifted to the top of the word
+// and padded with leading '0' so the same conversion applies
+inline bool epoch_read_digits(parse_cursor &cursor, unsigned long long &value, int &digits) {
+    const char *field = cursor.current;
+    value = 0;
+    digits = 0;
+    for (;;) {
+        const long long remaining = cursor.end - cursor.current;
+        unsigned long long word = 0;
+        if (remaining >= 8) {
+            word = datetime_swar_load(cursor.current);
+        } else {
+            // Zero padded so nothing past the input is read, zero bytes end the run
+            char tail[8] = {};
+            for (int i = 0; i < remaining; i++) tail[i] = cursor.current[i];
+            word = datetime_swar_load(tail);
+        }
+        const int run = datetime_swar_digit_run(datetime_swar_digit_flags(word));
+        if (run > 0) {
+            if (digits + run > 19)
+                return cursor.fail(parse_error::invalid_epoch, field);
+            const unsigned long long aligned = run == 8 ? word : (word << (64 - 8 * run)) | (0x3030303030303030ULL >> (8 * run));
+            value = value * epoch_pow10[run] + datetime_swar_eight_digits(aligned);
+            cursor.current += run;
+            digits += run;
+        }
+        if (run < 8)
+            break;
+    }
+    if (digits == 0)
+        return cursor.fail(cursor.current == cursor.end ? parse_error::unexpected_end : parse_error::expected_digit, cursor.current);
+    return true;
+}
+
+/**
+ * Parses a numeric epoch string: an optional '-', up to 19 digits and an optional '.' followed by 1 - 9 fraction digits
+ * of the unit. The input is length bounded and fully validated, negative values round towards the past.
+ *
+ * @param text The epoch string, does not need to be null terminated.
+ * @param length The number of characters of text.
+ * @param out The parsed datetime, DATETIME_INVALID on failure.
+ * @param unit The unit of the number, or autodetect to pick it from the number of integer digits.
+ * @return The error and its byte position.
+ */
+inline parse_result parse_epoch(const char *text, int length, datetime &out, epoch_unit unit = epoch_unit::autodetect) {
+    out = DATETIME_INVALID;
+    parse_cursor cursor = make_parse_cursor(text, length);
+    const auto fail = [&cursor](parse_error error, const char *at) {
+        cursor.fail(error, at);
+        return cursor.result;
+    };
+    const bool negative = length > 0 && *text == '-';
+    cursor.current += negative;
+    const char *field = cursor.current;
+    unsigned long long value = 0;
+    int digits = 0;
+    if (!epoch_read_digits(cursor, value, digits))
+        return cursor.result;
+    if (unit == epoch_unit::autodetect) {
+        unit = digits <= 10   ? epoch_unit::seconds
+               : digits <= 13 ? epoch_unit::milliseconds
+               : digits <= 16 ? epoch_unit::microseconds
+                              : epoch_unit::nanoseconds;
+    }
+
+    // Fraction in billionths of the unit
+    unsigned long long fraction = 0;
+    if (cursor.current != cursor.end && *cursor.current == '.') {
+        cursor.current++;
+        int fraction_value = 0, fraction_digits = 0;
+        if (!parse_checked_digit_run(cursor, 9, parse_error::invalid_epoch, fraction_value, fraction_digits))
+            return cursor.result;
+        fraction = static_cast<unsigned long long>(fraction_value) * static_cast<unsigned long long>(pow10_table[9 - fraction_digits]);
+    }
+    if (cursor.current != cursor.end)
+        return fail(parse_error::trailing_characters, cursor.current);
+
+    unsigned long long magnitude = 0;
+    bool inexact = false;
+    if (unit == epoch_unit::nanoseconds) {
+        magnitude = value / 1000;
+        inexact = value % 1000 != 0 || fraction != 0;
+    } else {
+        const unsigned long long per_unit = static_cast<unsigned long long>(epoch_unit_microseconds[static_cast<int>(unit)]);
+        if (value > DATETIME_EPOCH_MAX_MAGNITUDE / per_unit)
+            return fail(parse_error::invalid_epoch, field);
+        const unsigned long long scaled_fraction = fraction * per_unit;
+        magnitude = value * per_unit + scaled_fraction / 1000000000ULL;
+        inexact = scaled_fraction % 1000000000ULL != 0;
+    }
+    magnitude += negative && inexact;
+    if (magnitude > DATETIME_EPOCH_MAX_MAGNITUDE)
+        return fail(parse_error::invalid_epoch, field);
+    out = negative ? -static_cast<long long>(magnitude) : static_cast<long long>(magnitude);
+    return {};
+}
+
+/**
+ * @brief Parses count epoch strings with the same unit.
+ * @return The number of strings parsed, failures are set to DATETIME_INVALID.
+ */
+inline long long parse_epoch_bulk(const char *const *texts, const int *lengths, datetime *out, long long count,
+                                  epoch_unit unit = epoch_unit::autodetect) {
+    long long parsed = 0;
+    for (long long i = 0; i < count; i++) parsed += static_cast<bool>(parse_epoch(texts[i], lengths[i], out[i], unit));
+    return parsed;
+}
+
+// Writes the digits of value and returns their count
+inline int epoch_put_integer(char *out, unsigned long long value) {
+    char buffer[20];
+    char *p = buffer + sizeof(buffer);
+    while (value >= 100) {
+        p -= 2;
+        datetime_put_pair(p, static_cast<int>(value % 100));
+        value /= 100;
+    }
+    if (value >= 10) {
+        p -= 2;
+        datetime_put_pair(p, static_cast<int>(value));
+    } else {
+        *--p = static_cast<char>('0' + value);
+    }
+    const int digits = static_cast<int>(buffer + sizeof(buffer) - p);
+    for (int i = 0; i < digits; i++) out[i] = p[i];
+    return digits;
+}
+
+/**
+ * Writes the datetime as a numeric epoch string.
+ *
+ * Without fraction digits the value is rounded towards the past, like time_t. With fraction digits seconds and
+ * milliseconds are written as sign, integer and fraction, e.g. "-1.500000".
+ *
+ * @param date The datetime.
+ * @param out The output buffer, at least DATETIME_EPOCH_CAPACITY + 1 characters.
+ * @param unit The unit to write, autodetect writes microseconds.
+ * @param fraction_digits Digits after the decimal point (0 - 9) for seconds and milliseconds, ignored otherwise.
+ * @return The number of characters written, not counting the terminator.
+ */
+inline int format_epoch(datetime date, char *out, epoch_unit unit = epoch_unit::seconds, int fraction_digits = 0) {
+    if (unit == epoch_unit::autodetect)
+        unit = epoch_unit::microseconds;
+    const long long per_unit = epoch_unit_microseconds[static_cast<int>(unit)];
+    const bool fraction = fraction_digits > 0 && per_unit > 1;
+    char *p = out;
+    unsigned long long magnitude = 0;
+    unsigned long long remainder = 0;
+    if (fraction) {
+        *p = '-';
+        p += date.data < 0;
+        const unsigned long long micro = date.data < 0 ? 0ULL - static_cast<unsigned long long>(date.data) : static_cast<unsigned long long>(date.data);
+        magnitude = micro / static_cast<unsigned long long>(per_unit);
+        remainder = micro % static_cast<unsigned long long>(per_unit);
+    } else {
+        const long long floored = date.data / per_unit - (date.data % per_unit < 0);
+        *p = '-';
+        p += floored < 0;
+        magnitude = floored < 0 ? 0ULL - static_cast<unsigned long long>(floored) : static_cast<unsigned long long>(floored);
+    }
+    p += epoch_put_integer(p, magnitude);
+    if (unit == epoch_unit::nanoseconds && magnitude != 0) {
+        p[0] = p[1] = p[2] = '0';
+        p += 3;
+    }
+    if (fraction) {
+        const int digits = fraction_digits < 9 ? fraction_digits : 9;
+        *p++ = '.';
+        // The remainder scaled to a microsecond value of a whole second, digits past it are zero
+        datetime_put_microsecond(p, digits, static_cast<int>(remainder * static_cast<unsigned long long>(1000000LL / per_unit)));
+        p += digits;
+    }
+    end_string(p);
+    return static_cast<int>(p - out);
+}
+
+/**
+ * @brief Writes the datetime as a numeric epoch string into an inline string.
+ */
+inline datetime_string<DATETIME_EPOCH_CAPACITY> to_epoch_string(datetime date, epoch_unit unit = epoch_unit::seconds, int fraction_digits = 0) {
+    datetime_string<DATETIME_EPOCH_CAPACITY> result;
+    result.length = format_epoch(date, result.buffer, unit, fraction_digits);
+    return result;
+}
+
+// Length of the leading sign, digits and fraction, at most limit characters
+inline int epoch_text_length(const char *text, int limit) {
+    int length = limit > 0 && *text == '-';
+    bool point = false;
+    while (length < limit && (is_numeric(text[length]) || (text[length] == '.' && !point))) {
+        point |= text[length] == '.';
+        length++;
+    }
+    return length;
+}
+
+// A whole epoch timestamp as a perfect_parser field, e.g. perfect_parser<epoch_field<epoch_unit::milliseconds>>
+template <epoch_unit Unit = epoch_unit::autodetect> struct epoch_field {
+    static constexpr int max_size = DATETIME_EPOCH_CAPACITY;
+    static constexpr int fixed_size = -1;
+    static constexpr char layout = 'd';
+
+    static inline int parse(const char **state, datetime_struct &pack) {
+        // The input ends at the first character that cannot be part of the number
+        const int length = epoch_text_length(*state, DATETIME_EPOCH_CAPACITY);
+        datetime date;
+        if (parse_epoch(*state, length, date, Unit))
+            date.to_pack(pack);
+        (*state) += length;
+        return 1;
+    }
+
+    static inline bool parse_checked(parse_cursor &cursor, datetime_struct &pack) {
+        const int length = epoch_text_length(cursor.current, static_cast<int>(cursor.end - cursor.current));
+        datetime date;
+        const parse_result result = parse_epoch(cursor.current, length, date, Unit);
+        if (!result)
+            return cursor.fail(result.error, cursor.current + result.position);
+        date.to_pack(pack);
+        cursor.current += length;
+        return true;
+    }
+
+    // Puts using template argument
+    static inline void puts(char **out, datetime_struct &pack) {
+        *out += format_epoch(datetime(pack.to_datetime()), *out, Unit == epoch_unit::autodetect ? epoch_unit::microseconds : Unit);
+    }
+};
+} // namespace gtr
+#endif
@@ -0,0 +1,300 @@
+#ifndef DATETIME_INDEX_H
+#define DATETIME_INDEX_H
+#include "datetime_calendar.h"
+#include <vector>
+
+// A read-only search index over a sorted array of datetimes. The array is split into blocks of
+// DATETIME_INDEX_BLOCK entries and the last time of every block is stored in Eytzinger (breadth first)
+// order, so a search walks a tree whose upper levels stay in cache and whose next levels can be
+// prefetched. The block found is then counted with a branchless loop the compiler vectorizes.
+// An optional directory of fixed-width buckets (a day, a minute, ...) seeks to a bucket in O(1).
+// Period boundaries of a sorted array are found by galloping from one boundary to the next.
+namespace gtr {
+
+/**
+ * @brief The number of sorted entries compared at the leaves, 128 bytes.
+ */
+constexpr int DATETIME_INDEX_BLOCK = 16;
+
+/**
+ * @brief A directory is not built when it would hold more buckets than this many times the entries.
+ */
+constexpr long long DATETIME_INDEX_MAX_BUCKETS_PER_ENTRY = 4;
+
+/**
+ * @brief The positions [begin, end) of the sorted array.
+ */
+struct index_span {
+    long long begin{0};
+    long long end{0};
+
+    inline constexpr long long size() const { return end - begin; }
+    inline constexpr bool empty() const { return begin == end; }
+};
+
+/**
+ * Searches a sorted array of datetimes faster than std::lower_bound on large arrays.
+ *
+ * The index only keeps a pointer to the array, which must outlive it and not change.
+ */
+class time_index {
+  public:
+    time_index() = default;
+
+    /**
+     * @brief Builds the index, see build.
+     */
+    time_index(const datetime *sorted, long long count, long long bucket_width = 0) { build(sorted, count, bucket_width); }
+
+    /**
+     * @brief Builds the index over a sorted array.
+     * @param sorted The datetimes in non decreasing order.
+     * @param count The number of datetimes.
+     * @param bucket_width Microseconds covered by each bucket of the directory, e.g. 60000000 for minutes.
+     *                     0 builds no directory.
+     * @return False if the directory was requested but would be too large, the index is usable without it.
+     */
+    inline bool build(const datetime *sorted, long long count, long long bucket_width = 0) {
+        data_ = sorted;
+        count_ = count;
+        const long long blocks = (count + DATETIME_INDEX_BLOCK - 1) / DATETIME_INDEX_BLOCK;
+        tree_.assign(static_cast<size_t>(blocks + 1), 0);
+        block_.assign(static_cast<size_t>(blocks + 1), 0);
+        long long next_block = 0;
+        fill(1, blocks, next_block);
+        return build_directory(bucket_width);
+    }
+
+    inline long long size() const { return count_; }
+
+    inline bool has_directory() const { return bucket_width_ > 0; }
+
+    /**
+     * @brief Returns the position of the first entry not before time, size() if there is none.
+     */
+    inline long long lower_bound(datetime time) const {
+        if (bucket_width_ > 0)
+            return directory_lower_bound(time.data);
+        return tree_lower_bound(time.data);
+    }
+
+    /**
+     * @brief Returns the position of the first entry after time, size() if there is none.
+     */
+    inline long long upper_bound(datetime time) const {
+        if (time.data == DATETIME_MAX)
+            return count_;
+        return lower_bound(time.data + 1);
+    }
+
+    /**
+     * @brief Returns the positions of the entries in [from, to).
+     */
+    inline index_span range(datetime from, datetime to) const {
+        const long long begin = lower_bound(from);
+        if (to.data <= from.data)
+            return {begin, begin};
+        return {begin, lower_bound(to)};
+    }
+
+    /**
+     * @brief Returns the positions of the entries of the directory bucket holding time, without searching.
+     *
+     * Empty when there is no directory or time is outside the indexed times.
+     */
+    inline index_span bucket(datetime time) const {
+        const long long index = bucket_of(time.data);
+        if (bucket_width_ == 0 || index < 0 || index >= bucket_count())
+            return {};
+        return {directory_[static_cast<size_t>(index)], directory_[static_cast<size_t>(index + 1)]};
+    }
+
+    /**
+     * @brief Finds the lower bound of every time, interleaving the searches to overlap their cache misses.
+     */
+    inline void lower_bound_bulk(const datetime *times, long long *out, long long count) const {
+        constexpr int group = 8;
+        long long i = 0;
+        if (bucket_width_ == 0) {
+            for (; i + group <= count; i += group) {
+                long long node[group];
+                for (int j = 0; j < group; j++) node[j] = 1;
+                for (long long level = tree_size(); level > 0; level >>= 1)
+                    for (int j = 0; j < group; j++) node[j] = descend(node[j], times[i + j].data);
+                for (int j = 0; j < group; j++) out[i + j] = finish(node[j], times[i + j].data);
+            }
+        }
+        for (; i < count; i++) out[i] = lower_bound(times[i]);
+    }
+
+  private:
+    static constexpr long long DATETIME_MAX = 9223372036854775807LL;
+
+    const datetime *data_{nullptr};
+    long long count_{0};
+    std::vector<long long> tree_;  // the last time of each block, Eytzinger order from 1
+    std::vector<long long> block_; // the block of each tree node
+    long long origin_{0};
+    long long bucket_width_{0};
+    std::vector<long long> directory_; // the first position of each bucket, followed by count_
+
+    inline long long tree_size() const { return static_cast<long long>(tree_.size()) - 1; }
+
+    inline long long block_last(long long block) const {
+        const long long last = block * DATETIME_INDEX_BLOCK + DATETIME_INDEX_BLOCK - 1;
+        return data_[last < count_ ? last : count_ - 1].data;
+    }
+
+    // An in-order walk assigns the blocks in sorted order
+    inline void fill(long long node, long long blocks, long long &next_block) {
+        if (node > blocks)
+            return;
+        fill(2 * node, blocks, next_block);
+        tree_[static_cast<size_t>(node)] = block_last(next_block);
+        block_[static_cast<size_t>(node)] = next_block++;
+        fill(2 * node + 1, blocks, next_block);
+    }
+
+    inline long long descend(long long node, long long time) const {
+        if (node > tree_size())
+            return node;
+#if defined(__GNUC__)
+        // Eight nodes per cache line, the descendants three levels down are contiguous
+        __builtin_prefetch(tree_.data() + (node * 8 < static_cast<long long>(tree_.size()) ? node * 8 : 0));
+#endif
+        return 2 * node + (tree_[static_cast<size_t>(node)] < time);
+    }
+
+    // Climbs back to the last node where the search went left, the first block whose last time is not before time
+    inline long long finish(long long node, long long time) const {
+        node >>= datetime_count_trailing_zeros(~static_cast<unsigned long long>(node)) + 1;
+        if (node == 0)
+            return count_;
+        const long long block = block_[static_cast<size_t>(node)];
+        return block * DATETIME_INDEX_BLOCK + count_before(block * DATETIME_INDEX_BLOCK, time);
+    }
+
+    inline long long count_before(long long first, long long time) const {
+        const datetime *entries = data_ + first;
+        int before = 0;
+        if (count_ - first >= DATETIME_INDEX_BLOCK) {
+            for (int i = 0; i < DATETIME_INDEX_BLOCK; i++) before += entries[i].data < time;
+        } else {
+            for (long long i = 0; i < count_ - first; i++) before += entries[i].data < time;
+        }
+        return before;
+    }
+
+    inline long long tree_lower_bound(long long time) const {
+        long long node = 1;
+        while (node <= tree_size()) node = descend(node, time);
+        return finish(node, time);
+    }
+
+    // Branchless binary search of a directory bucket
+    inline long long bucket_lower_bound(long long first, long long length, long long time) const {
+        const datetime *base = data_ + first;
+        while (length > 1) {
+            const long long half = length / 2;
+            base = base[half - 1].data < time ? base + half : base;
+            length -= half;
+        }
+        return (base - data_) + (length == 1 && base->data < time);
+    }
+
+    inline long long bucket_count() const { return static_cast<long long>(directory_.size()) - 1; }
+
+    inline long long bucket_of(long long time) const {
+        // Floored, times before the origin give negative buckets
+        const long long offset = time - origin_;
+        return offset / bucket_width_ - (offset % bucket_width_ < 0);
+    }
+
+    inline long long directory_lower_bound(long long time) const {
+        if (time <= origin_)
+            return 0;
+        const long long index = bucket_of(time);
+        if (index >= bucket_count())
+            return count_;
+        const long long first = directory_[static_cast<size_t>(index)];
+        return bucket_lower_bound(first, directory_[static_cast<size_t>(index + 1)] - first, time);
+    }
+
+    inline bool build_directory(long long bucket_width) {
+        bucket_width_ = 0;
+        directory_.clear();
+        if (bucket_width <= 0 || count_ == 0)
+            return true;
+        // Buckets aligned on multiples of the width, so day buckets start at midnight UTC
+        const long long first = data_[0].data, last = data_[count_ - 1].data;
+        const long long origin = first - (first % bucket_width + bucket_width) % bucket_width;
+        const unsigned long long span = static_cast<unsigned long long>(last) - static_cast<unsigned long long>(origin);
+        const unsigned long long buckets = span / static_cast<unsigned long long>(bucket_width) + 1;
+        if (buckets > static_cast<unsigned long long>(count_) * DATETIME_INDEX_MAX_BUCKETS_PER_ENTRY + 1024)
+            return false;
+        origin_ = origin;
+        directory_.resize(static_cast<size_t>(buckets + 1));
+        long long position = 0;
+        for (unsigned long long b = 0; b < buckets; b++) {
+            const long long begin = origin + static_cast<long long>(b) * bucket_width;
+            while (position < count_ && data_[position].data < begin) position++;
+            directory_[static_cast<size_t>(b)] = position;
+        }
+        directory_[static_cast<size_t>(buckets)] = count_;
+        bucket_width_ = bucket_width;
+        return true;
+    }
+};
+/**
+ * @brief Returns the position of the first entry not before time, searching forward from position first.
+ *
+ * Gallops (1, 2, 4, ... entries ahead) and then binary searches, so it takes O(log d) comparisons for an answer d
+ * entries away.
+ */
+inline long long gallop_lower_bound(const datetime *sorted, long long count, long long first, long long time) {
+    if (first >= count || sorted[first].data >= time)
+        return first;
+    // sorted[low] is before time, sorted[high] is not or high is count
+    long long low = first, step = 1;
+    while (low + step < count && sorted[low + step].data < time) {
+        low += step;
+        step *= 2;
+    }
+    long long high = low + step < count ? low + step : count;
+    while (high - low > 1) {
+        const long long middle = low + (high - low) / 2;
+        if (sorted[middle].data < time)
+            low = middle;
+        else
+            high = middle;
+    }
+    return high;
+}
+
+/**
+ * @brief Returns the position of the first entry in a later period than sorted[first], count if there is none.
+ */
+inline long long next_period_change(const datetime *sorted, long long count, long long first, calendar_period period) {
+    if (first >= count)
+        return count;
+    return gallop_lower_bound(sorted, count, first + 1, datetime_next_period(sorted[first].data, period));
+}
+
+/**
+ * @brief Finds the positions where the period of a sorted array changes.
+ *
+ * Each boundary is computed once from the first entry of its period and found by galloping, so a dense array costs
+ * a few comparisons per period instead of one calendar comparison per pair.
+ * @param out Receives the position of the first entry of every period after the first, at most count - 1 positions.
+ * @return The number of positions written.
+ */
+inline long long period_boundaries(const datetime *sorted, long long count, calendar_period period, long long *out) {
+    long long written = 0;
+    for (long long position = next_period_change(sorted, count, 0, period); position < count;
+         position = next_period_change(sorted, count, position, period))
+        out[written++] = position;
+    return written;
+}
+
+} // namespace gtr
+#endif
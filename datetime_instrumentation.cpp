@@ -0,0 +1,134 @@
+#include "datetime_instrumentation.h"
+#include <cstdio>
+#ifdef DATETIME_INSTRUMENTATION
+#include <mutex>
+#include <vector>
+#endif
+namespace gtr {
+
+static const char *const instrumented_call_names[] = {"parse_datetime_string", "datetime_to_string", "epoch_to_datetime_pack",
+                                                      "seconds_since_epoch", "now"};
+static const char *const instrumented_cache_names[] = {"decode_table"};
+
+const char *instrumented_call_name(instrumented_call call) { return instrumented_call_names[static_cast<int>(call)]; }
+
+const char *instrumented_cache_name(instrumented_cache cache) { return instrumented_cache_names[static_cast<int>(cache)]; }
+
+#ifdef DATETIME_INSTRUMENTATION
+// The live threads, the totals of the threads that exited and the totals at the last reset
+struct instrumentation_registry {
+    std::mutex mutex;
+    std::vector<instrumentation_counters *> threads;
+    instrumentation_snapshot exited;
+    instrumentation_snapshot baseline;
+};
+
+static instrumentation_registry &registry() {
+    static instrumentation_registry instance;
+    return instance;
+}
+
+// Adds the counters of one thread, the maximum is kept as a maximum
+static void instrumentation_accumulate(instrumentation_snapshot &total, const instrumentation_counters &counters) {
+    for (int i = 0; i < DATETIME_INSTRUMENTED_CALLS; i++) {
+        call_statistics &call = total.calls[i];
+        call.calls += counters.calls[i].load(std::memory_order_relaxed);
+        call.sampled += counters.sampled[i].load(std::memory_order_relaxed);
+        call.sampled_ns += counters.sampled_ns[i].load(std::memory_order_relaxed);
+        const long long max_ns = counters.max_ns[i].load(std::memory_order_relaxed);
+        call.max_ns = max_ns > call.max_ns ? max_ns : call.max_ns;
+    }
+    for (int i = 0; i < DATETIME_INSTRUMENTED_CACHES; i++) {
+        total.caches[i].hits += counters.hits[i].load(std::memory_order_relaxed);
+        total.caches[i].misses += counters.misses[i].load(std::memory_order_relaxed);
+    }
+}
+
+instrumentation_thread::instrumentation_thread() {
+    instrumentation_registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.threads.push_back(&counters);
+}
+
+instrumentation_thread::~instrumentation_thread() {
+    instrumentation_registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    instrumentation_accumulate(shared.exited, counters);
+    for (size_t i = 0; i < shared.threads.size(); i++) {
+        if (shared.threads[i] == &counters) {
+            shared.threads[i] = shared.threads.back();
+            shared.threads.pop_back();
+            break;
+        }
+    }
+}
+
+bool instrumentation_enabled() { return true; }
+
+// The totals since the process started
+static instrumentation_snapshot instrumentation_total(instrumentation_registry &shared) {
+    instrumentation_snapshot total = shared.exited;
+    for (const instrumentation_counters *counters : shared.threads) instrumentation_accumulate(total, *counters);
+    return total;
+}
+
+instrumentation_snapshot instrumentation_read() {
+    instrumentation_registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    instrumentation_snapshot snapshot = instrumentation_total(shared);
+    for (int i = 0; i < DATETIME_INSTRUMENTED_CALLS; i++) {
+        snapshot.calls[i].calls -= shared.baseline.calls[i].calls;
+        snapshot.calls[i].sampled -= shared.baseline.calls[i].sampled;
+        snapshot.calls[i].sampled_ns -= shared.baseline.calls[i].sampled_ns;
+    }
+    for (int i = 0; i < DATETIME_INSTRUMENTED_CACHES; i++) {
+        snapshot.caches[i].hits -= shared.baseline.caches[i].hits;
+        snapshot.caches[i].misses -= shared.baseline.caches[i].misses;
+    }
+    return snapshot;
+}
+
+void instrumentation_reset() {
+    instrumentation_registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    // Other threads own their counters, so sums are reset against a baseline and only the maximums are cleared
+    for (instrumentation_counters *counters : shared.threads)
+        for (int i = 0; i < DATETIME_INSTRUMENTED_CALLS; i++) counters->max_ns[i].store(0, std::memory_order_relaxed);
+    for (call_statistics &call : shared.exited.calls) call.max_ns = 0;
+    shared.baseline = instrumentation_total(shared);
+}
+#else
+bool instrumentation_enabled() { return false; }
+
+instrumentation_snapshot instrumentation_read() { return {}; }
+
+void instrumentation_reset() {}
+#endif
+
+int format_instrumentation_report(const instrumentation_snapshot &snapshot, char *out, int capacity) {
+    int length = 0;
+    // Counts the whole report while writing what fits
+    const auto append = [&](int written) {
+        length += written > 0 ? written : 0;
+        return length < capacity ? out + length : nullptr;
+    };
+    if (capacity > 0)
+        out[0] = '\0';
+    char *p = append(0);
+    for (int i = 0; i < DATETIME_INSTRUMENTED_CALLS; i++) {
+        const call_statistics &call = snapshot.calls[i];
+        if (call.calls == 0)
+            continue;
+        p = append(std::snprintf(p, p ? static_cast<size_t>(capacity - length) : 0, "%-24s calls %lld  mean %.1fns  max %lldns  (%lld timed)\n",
+                                 instrumented_call_names[i], call.calls, call.mean_ns(), call.max_ns, call.sampled));
+    }
+    for (int i = 0; i < DATETIME_INSTRUMENTED_CACHES; i++) {
+        const cache_statistics &cache = snapshot.caches[i];
+        if (cache.hits + cache.misses == 0)
+            continue;
+        p = append(std::snprintf(p, p ? static_cast<size_t>(capacity - length) : 0, "%-24s hits %lld  misses %lld  hit ratio %.3f\n",
+                                 instrumented_cache_names[i], cache.hits, cache.misses, cache.hit_ratio()));
+    }
+    return length;
+}
+} // namespace gtr
@@ -0,0 +1,166 @@
+#ifndef DATETIME_INSTRUMENTATION_H
+#define DATETIME_INSTRUMENTATION_H
+#ifdef DATETIME_INSTRUMENTATION
+#include <atomic>
+#include <chrono>
+#endif
+
+// Opt-in counters of the library's hot entry points, compiled in with DATETIME_INSTRUMENTATION (CMake option
+// GTR_DATETIME_INSTRUMENTATION) and compiled out entirely otherwise. Every call is counted and one in
+// DATETIME_INSTRUMENTATION_SAMPLE is timed. Each thread writes its own counters without atomic read-modify-writes,
+// readers add up all threads.
+#ifndef DATETIME_INSTRUMENTATION_SAMPLE
+#define DATETIME_INSTRUMENTATION_SAMPLE 64
+#endif
+
+namespace gtr {
+
+/**
+ * @brief The instrumented functions.
+ */
+enum class instrumented_call {
+    parse_datetime_string,  /**< datetime(const char *, ...) and from_string. */
+    datetime_to_string,     /**< to_string, to_string_format and format_to. */
+    epoch_to_datetime_pack, /**< Decoding a datetime into its fields without the decode table. */
+    seconds_since_epoch,    /**< Encoding fields into a datetime. */
+    now,                    /**< datetime::now. */
+    count,
+};
+
+/**
+ * @brief The instrumented caches.
+ */
+enum class instrumented_cache {
+    decode_table, /**< Dates decoded through the decode table (DATETIME_DECODE_TABLE) against those outside it. */
+    count,
+};
+
+constexpr int DATETIME_INSTRUMENTED_CALLS = static_cast<int>(instrumented_call::count);
+constexpr int DATETIME_INSTRUMENTED_CACHES = static_cast<int>(instrumented_cache::count);
+
+struct call_statistics {
+    long long calls{0};
+    long long sampled{0};    /**< The calls that were timed. */
+    long long sampled_ns{0}; /**< Their total time. */
+    long long max_ns{0};     /**< The slowest timed call. */
+
+    inline double mean_ns() const { return sampled == 0 ? 0.0 : static_cast<double>(sampled_ns) / static_cast<double>(sampled); }
+};
+
+struct cache_statistics {
+    long long hits{0};
+    long long misses{0};
+
+    inline double hit_ratio() const { return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses); }
+};
+
+/**
+ * @brief The counters of all threads since the last reset, the threads that exited included.
+ */
+struct instrumentation_snapshot {
+    call_statistics calls[DATETIME_INSTRUMENTED_CALLS];
+    cache_statistics caches[DATETIME_INSTRUMENTED_CACHES];
+
+    inline const call_statistics &operator[](instrumented_call call) const { return calls[static_cast<int>(call)]; }
+    inline const cache_statistics &operator[](instrumented_cache cache) const { return caches[static_cast<int>(cache)]; }
+};
+
+/**
+ * @brief True if the library was built with DATETIME_INSTRUMENTATION, otherwise snapshots are all zero.
+ */
+bool instrumentation_enabled();
+
+/**
+ * @brief Adds up the counters of every thread, safe while other threads keep counting.
+ */
+instrumentation_snapshot instrumentation_read();
+
+/**
+ * @brief Starts the counters over. Calls racing with the reset may keep their maximum.
+ */
+void instrumentation_reset();
+
+/**
+ * @brief Writes the snapshot as text, a line per function and cache with a nonzero count.
+ * @return The length of the whole report, like snprintf; only capacity - 1 characters and the terminator are written.
+ */
+int format_instrumentation_report(const instrumentation_snapshot &snapshot, char *out, int capacity);
+
+const char *instrumented_call_name(instrumented_call call);
+const char *instrumented_cache_name(instrumented_cache cache);
+
+#ifdef DATETIME_INSTRUMENTATION
+// The counters of one thread, written by that thread only
+struct instrumentation_counters {
+    std::atomic<long long> calls[DATETIME_INSTRUMENTED_CALLS];
+    std::atomic<long long> sampled[DATETIME_INSTRUMENTED_CALLS];
+    std::atomic<long long> sampled_ns[DATETIME_INSTRUMENTED_CALLS];
+    std::atomic<long long> max_ns[DATETIME_INSTRUMENTED_CALLS];
+    std::atomic<long long> hits[DATETIME_INSTRUMENTED_CACHES];
+    std::atomic<long long> misses[DATETIME_INSTRUMENTED_CACHES];
+};
+
+// Registers the counters of a thread for its lifetime, folding them into the totals of exited threads at exit
+struct instrumentation_thread {
+    instrumentation_counters counters{};
+
+    instrumentation_thread();
+    ~instrumentation_thread();
+};
+
+inline thread_local instrumentation_thread instrumentation_local;
+
+// A plain increment, the owning thread is the only writer
+inline void instrumentation_add(std::atomic<long long> &counter, long long value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// Counts a call for its scope and times one in DATETIME_INSTRUMENTATION_SAMPLE
+class instrumentation_scope {
+  public:
+    explicit inline instrumentation_scope(instrumented_call call) : call_(static_cast<int>(call)) {
+        instrumentation_counters &counters = instrumentation_local.counters;
+        const long long calls = counters.calls[call_].load(std::memory_order_relaxed);
+        counters.calls[call_].store(calls + 1, std::memory_order_relaxed);
+        if (calls % DATETIME_INSTRUMENTATION_SAMPLE == 0) {
+            sampled_ = true;
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    inline ~instrumentation_scope() {
+        if (!sampled_)
+            return;
+        const long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+        instrumentation_counters &counters = instrumentation_local.counters;
+        instrumentation_add(counters.sampled[call_], 1);
+        instrumentation_add(counters.sampled_ns[call_], elapsed);
+        if (elapsed > counters.max_ns[call_].load(std::memory_order_relaxed))
+            counters.max_ns[call_].store(elapsed, std::memory_order_relaxed);
+    }
+
+    instrumentation_scope(const instrumentation_scope &) = delete;
+    instrumentation_scope &operator=(const instrumentation_scope &) = delete;
+
+  private:
+    int call_;
+    bool sampled_{false};
+    std::chrono::steady_clock::time_point start_;
+};
+
+inline void instrumentation_cache(instrumented_cache cache, bool hit) {
+    instrumentation_counters &counters = instrumentation_local.counters;
+    instrumentation_add(hit ? counters.hits[static_cast<int>(cache)] : counters.misses[static_cast<int>(cache)], 1);
+}
+
+#define DATETIME_INSTRUMENT_CALL(call) const gtr::instrumentation_scope datetime_instrumentation_scope_(gtr::instrumented_call::call)
+#define DATETIME_INSTRUMENT_CACHE(cache, hit) gtr::instrumentation_cache(gtr::instrumented_cache::cache, hit)
+// Instrumented functions cannot be constexpr, the counters are not
+#define DATETIME_INSTRUMENTED_CONSTEXPR
+#else
+#define DATETIME_INSTRUMENT_CALL(call) ((void)0)
+#define DATETIME_INSTRUMENT_CACHE(cache, hit) ((void)0)
+#define DATETIME_INSTRUMENTED_CONSTEXPR constexpr
+#endif
+} // namespace gtr
+#endif
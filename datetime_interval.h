@@ -0,0 +1,276 @@
+#ifndef DATETIME_INTERVAL_H
+#define DATETIME_INTERVAL_H
+#include "datetime.h"
+#include <algorithm>
+#include <vector>
+
+// Intervals of time and a static index answering stabbing and overlap queries over millions of them.
+namespace gtr {
+
+/**
+ * A span of time, stored half open as [begin, end).
+ *
+ * Times are whole microseconds, so the closed interval [first, last] is the half open [first, last + 1)
+ * and both semantics share one representation. An interval with end <= begin is empty.
+ */
+struct datetime_interval {
+    datetime begin;
+    datetime end;
+
+    /**
+     * @brief The interval [begin, end).
+     */
+    static inline constexpr datetime_interval half_open(datetime begin, datetime end) { return {begin, end}; }
+
+    /**
+     * @brief The interval [first, last], both included.
+     */
+    static inline constexpr datetime_interval closed(datetime first, datetime last) { return {first, last.data + 1}; }
+
+    /**
+     * @brief The last microsecond of the interval, its end in closed semantics.
+     */
+    inline constexpr datetime last() const { return end.data - 1; }
+
+    inline constexpr bool empty() const { return end.data <= begin.data; }
+
+    /**
+     * @brief The length in microseconds, 0 when empty.
+     */
+    inline constexpr long long length() const { return empty() ? 0 : end.data - begin.data; }
+
+    inline constexpr bool contains(datetime time) const { return begin.data <= time.data && time.data < end.data; }
+
+    /**
+     * @brief True if every time of other is in this interval, always true for an empty other.
+     */
+    inline constexpr bool contains(const datetime_interval &other) const {
+        return other.empty() || (begin.data <= other.begin.data && other.end.data <= end.data);
+    }
+
+    /**
+     * @brief True if the intervals share at least one time, intervals that only touch do not overlap.
+     */
+    inline constexpr bool overlaps(const datetime_interval &other) const {
+        return !empty() && !other.empty() && begin.data < other.end.data && other.begin.data < end.data;
+    }
+
+    /**
+     * @brief The times in both intervals, empty if they do not overlap.
+     */
+    inline constexpr datetime_interval intersection(const datetime_interval &other) const {
+        const datetime_interval both{begin.data > other.begin.data ? begin : other.begin, end.data < other.end.data ? end : other.end};
+        return both.empty() ? datetime_interval{both.begin, both.begin} : both;
+    }
+
+    /**
+     * @brief The smallest interval holding both, ignoring empty intervals.
+     */
+    inline constexpr datetime_interval hull(const datetime_interval &other) const {
+        if (other.empty())
+            return *this;
+        if (empty())
+            return other;
+        return {begin.data < other.begin.data ? begin : other.begin, end.data > other.end.data ? end : other.end};
+    }
+
+    /**
+     * @brief The union of both intervals.
+     * @return False if there is a gap between them, the union is then not an interval and united is not set.
+     */
+    inline constexpr bool unite(const datetime_interval &other, datetime_interval &united) const {
+        if (!empty() && !other.empty() && (end.data < other.begin.data || other.end.data < begin.data))
+            return false;
+        united = hull(other);
+        return true;
+    }
+
+    inline constexpr bool operator==(const datetime_interval &other) const { return begin.data == other.begin.data && end.data == other.end.data; }
+    inline constexpr bool operator!=(const datetime_interval &other) const { return !(*this == other); }
+};
+
+/**
+ * Finds the intervals holding a time or overlapping an interval, in O(log n + matches).
+ *
+ * The intervals are sorted by begin and an implicit interval tree is laid over the sorted array: the node at
+ * position i has as many levels below it as i has trailing one bits, and stores the largest end of its subtree.
+ * Small subtrees are scanned linearly. Begins, ends and subtree ends are kept in separate arrays.
+ * Built once, the index does not keep a pointer to the intervals.
+ */
+class interval_index {
+  public:
+    interval_index() = default;
+
+    interval_index(const datetime_interval *intervals, long long count) { build(intervals, count); }
+
+    /**
+     * @brief Indexes the intervals, empty ones are left out.
+     */
+    inline void build(const datetime_interval *intervals, long long count) {
+        std::vector<long long> order;
+        order.reserve(static_cast<size_t>(count));
+        for (long long i = 0; i < count; i++)
+            if (!intervals[i].empty())
+                order.push_back(i);
+        std::sort(order.begin(), order.end(), [intervals](long long a, long long b) { return intervals[a].begin.data < intervals[b].begin.data; });
+        const size_t size = order.size();
+        begins_.resize(size);
+        ends_.resize(size);
+        subtree_ends_.resize(size);
+        ids_.swap(order);
+        sorted_ends_.resize(size);
+        for (size_t i = 0; i < size; i++) {
+            begins_[i] = intervals[ids_[i]].begin.data;
+            ends_[i] = sorted_ends_[i] = intervals[ids_[i]].end.data;
+        }
+        std::sort(sorted_ends_.begin(), sorted_ends_.end());
+        build_tree();
+    }
+
+    inline long long size() const { return static_cast<long long>(ids_.size()); }
+
+    /**
+     * @brief Calls visit(id) for each interval overlapping query, id being its position in the built array.
+     */
+    template <class Visit> inline void overlapping(const datetime_interval &query, Visit visit) const {
+        if (query.empty() || ids_.empty())
+            return;
+        const long long from = query.begin.data, to = query.end.data;
+        const long long count = size();
+        struct frame {
+            long long node;
+            int level;
+            bool left_done;
+        };
+        frame stack[128];
+        int top = 0;
+        stack[top++] = {(1LL << max_level_) - 1, max_level_, false};
+        while (top > 0) {
+            const frame current = stack[--top];
+            if (current.level <= DATETIME_INTERVAL_SCAN_LEVEL) {
+                // The whole subtree, positions first .. first + 2^(level + 1) - 2
+                const long long first = current.node >> current.level << current.level;
+                long long last = first + (1LL << (current.level + 1)) - 1;
+                last = last < count ? last : count;
+                for (long long i = first; i < last && begins_[static_cast<size_t>(i)] < to; i++)
+                    if (from < ends_[static_cast<size_t>(i)])
+                        visit(ids_[static_cast<size_t>(i)]);
+            } else if (!current.left_done) {
+                stack[top++] = {current.node, current.level, true};
+                const long long left = current.node - (1LL << (current.level - 1));
+                // Positions past the end have no subtree end of their own, their left subtree may still hold intervals
+                if (left >= count || subtree_ends_[static_cast<size_t>(left)] > from)
+                    stack[top++] = {left, current.level - 1, false};
+            } else if (current.node < count && begins_[static_cast<size_t>(current.node)] < to) {
+                if (from < ends_[static_cast<size_t>(current.node)])
+                    visit(ids_[static_cast<size_t>(current.node)]);
+                stack[top++] = {current.node + (1LL << (current.level - 1)), current.level - 1, false};
+            }
+        }
+    }
+
+    /**
+     * @brief Writes the ids of the intervals overlapping query.
+     * @return The number of overlapping intervals, only the first capacity are written.
+     */
+    inline long long overlapping(const datetime_interval &query, long long *out, long long capacity) const {
+        long long found = 0;
+        overlapping(query, [&](long long id) {
+            if (found < capacity)
+                out[found] = id;
+            found++;
+        });
+        return found;
+    }
+
+    /**
+     * @brief Writes the ids of the intervals holding time.
+     * @return The number of intervals holding time, only the first capacity are written.
+     */
+    inline long long stabbing(datetime time, long long *out, long long capacity) const {
+        if (time.data == DATETIME_MAX)
+            return 0;
+        return overlapping(datetime_interval{time, time.data + 1}, out, capacity);
+    }
+
+    /**
+     * @brief Returns the number of intervals holding time, from the sorted endpoints alone.
+     */
+    inline long long stabbing_count(datetime time) const {
+        const long long begun = std::upper_bound(begins_.begin(), begins_.end(), time.data) - begins_.begin();
+        const long long ended = std::upper_bound(sorted_ends_.begin(), sorted_ends_.end(), time.data) - sorted_ends_.begin();
+        return begun - ended;
+    }
+
+    /**
+     * @brief Counts the intervals holding each point. Sorted points are merged with the endpoints in one pass.
+     */
+    inline void stabbing_count_bulk(const datetime *points, long long *out, long long count) const {
+        long long begun = 0, ended = 0;
+        const long long intervals = size();
+        for (long long i = 0; i < count; i++) {
+            const long long time = points[i].data;
+            if (i > 0 && time < points[i - 1].data) {
+                // Out of order, start the merge over
+                begun = 0;
+                ended = 0;
+            }
+            while (begun < intervals && begins_[static_cast<size_t>(begun)] <= time) begun++;
+            while (ended < intervals && sorted_ends_[static_cast<size_t>(ended)] <= time) ended++;
+            out[i] = begun - ended;
+        }
+    }
+
+    /**
+     * @brief Calls visit(point, id) for each point and each interval holding it.
+     */
+    template <class Visit> inline void stabbing_bulk(const datetime *points, long long count, Visit visit) const {
+        for (long long i = 0; i < count; i++) {
+            if (points[i].data == DATETIME_MAX)
+                continue;
+            overlapping(datetime_interval{points[i], points[i].data + 1}, [&](long long id) { visit(i, id); });
+        }
+    }
+
+  private:
+    static constexpr long long DATETIME_MAX = 9223372036854775807LL;
+    // Subtrees of at most 2^(level + 1) - 1 positions are scanned instead of walked
+    static constexpr int DATETIME_INTERVAL_SCAN_LEVEL = 3;
+
+    std::vector<long long> begins_;       // sorted
+    std::vector<long long> ends_;         // in the order of begins_
+    std::vector<long long> subtree_ends_; // the largest end below each node
+    std::vector<long long> ids_;          // the position of each interval in the built array
+    std::vector<long long> sorted_ends_;  // sorted, for counting
+    int max_level_{0};
+
+    inline void build_tree() {
+        const long long count = size();
+        max_level_ = 0;
+        if (count == 0)
+            return;
+        // The subtree end of the last node on the right edge, standing in for the missing positions past the end
+        long long last_position = 0, last_end = 0;
+        for (long long i = 0; i < count; i += 2) {
+            last_position = i;
+            last_end = subtree_ends_[static_cast<size_t>(i)] = ends_[static_cast<size_t>(i)];
+        }
+        int level = 1;
+        for (; (1LL << level) <= count; level++) {
+            const long long half = 1LL << (level - 1);
+            for (long long i = 2 * half - 1; i < count; i += 4 * half) {
+                const long long left = subtree_ends_[static_cast<size_t>(i - half)];
+                const long long right = i + half < count ? subtree_ends_[static_cast<size_t>(i + half)] : last_end;
+                long long end = ends_[static_cast<size_t>(i)];
+                end = end > left ? end : left;
+                subtree_ends_[static_cast<size_t>(i)] = end > right ? end : right;
+            }
+            last_position = (last_position >> level & 1) ? last_position - half : last_position + half;
+            if (last_position < count && subtree_ends_[static_cast<size_t>(last_position)] > last_end)
+                last_end = subtree_ends_[static_cast<size_t>(last_position)];
+        }
+        max_level_ = level - 1;
+    }
+};
+} // namespace gtr
+#endif
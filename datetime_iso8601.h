@@ -0,0 +1,226 @@
+#ifndef DATETIME_ISO8601_H
+#define DATETIME_ISO8601_H
+#include "datetime_calendar.h"
+#include "datetime_parser.h"
+
+namespace gtr {
+
+/**
+ * @brief The maximum length of a string written by format_iso8601, not counting the terminator.
+ */
+constexpr int DATETIME_ISO8601_CAPACITY = 38;
+
+/**
+ * @brief The largest offset in minutes written by format_iso8601 and read by parse_iso8601, +-23:59.
+ */
+constexpr int DATETIME_ISO8601_MAX_OFFSET = 23 * 60 + 59;
+
+/**
+ * @brief Options of format_iso8601.
+ */
+struct iso8601_format {
+    int fraction_digits = 0; /**< Digits after the decimal point (0 - 9), digits past microseconds are zero. */
+    int offset_minutes = 0;  /**< Offset of the local time written, e.g. 330 writes the time at +05:30, at most +-23:59. */
+    bool basic = false;      /**< Basic format (20240610T123456Z) instead of extended (2024-06-10T12:34:56Z). */
+    bool utc_as_z = true;    /**< Writes Z instead of +00:00 when the offset is zero. */
+    char separator = 'T';    /**< The date/time separator, 'T' or ' '. */
+};
+
+/**
+ * Parses an ISO 8601 / RFC 3339 datetime and normalizes it to UTC.
+ *
+ * Accepted forms:
+ * - Date: YYYY-MM-DD (extended) or YYYYMMDD (basic). A date alone is midnight UTC.
+ * - Date/time separator: 'T', 't' or ' '.
+ * - Time: hh, hh:mm, hh:mm:ss (extended) or hh, hhmm, hhmmss (basic).
+ * - Fraction after the seconds: '.' or ',' followed by 1 - 9 digits, truncated to microseconds.
+ * - Offset: 'Z', 'z', +hh:mm, +hhmm or +hh (or '-'). Without an offset the time is taken as UTC.
+ *
+ * The input is length bounded and fully validated, like datetime::from_string_safe.
+ *
+ * @param date The string representation of the datetime, does not need to be null terminated.
+ * @param length The number of characters of date.
+ * @param out The parsed datetime in UTC, DATETIME_INVALID on failure.
+ * @return The error and its byte position.
+ */
+inline parse_result parse_iso8601(const char *date, int length, datetime &out) {
+    out = DATETIME_INVALID;
+    parse_cursor cursor = make_parse_cursor(date, length);
+    const auto fail = [&cursor](parse_error error, const char *at) {
+        cursor.fail(error, at);
+        return cursor.result;
+    };
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0, microsecond = 0;
+
+    if (!parse_checked_digits(cursor, 4, year))
+        return cursor.result;
+    if (year < 1)
+        return fail(parse_error::invalid_year, date);
+    const bool extended = cursor.current != cursor.end && *cursor.current == '-';
+    cursor.current += extended;
+    const char *field = cursor.current;
+    if (!parse_checked_digits(cursor, 2, month))
+        return cursor.result;
+    if (month < 1 || month > 12)
+        return fail(parse_error::invalid_month, field);
+    if (extended) {
+        if (cursor.current == cursor.end)
+            return fail(parse_error::unexpected_end, cursor.current);
+        if (*cursor.current != '-')
+            return fail(parse_error::expected_separator, cursor.current);
+        cursor.current++;
+    }
+    field = cursor.current;
+    if (!parse_checked_digits(cursor, 2, day))
+        return cursor.result;
+    if (day < 1 || day > datetime::month_day_count(month, year))
+        return fail(parse_error::invalid_day, field);
+
+    int offset_minutes = 0;
+    if (cursor.current != cursor.end) {
+        const char separator = *cursor.current;
+        if (separator != 'T' && separator != 't' && separator != ' ')
+            return fail(parse_error::expected_separator, cursor.current);
+        cursor.current++;
+
+        field = cursor.current;
+        if (!parse_checked_digits(cursor, 2, hour))
+            return cursor.result;
+        if (hour > 23)
+            return fail(parse_error::invalid_hour, field);
+        // Each further component is optional, extended components are introduced by ':'
+        const auto next_component = [&cursor]() {
+            if (cursor.current == cursor.end)
+                return false;
+            if (*cursor.current == ':') {
+                cursor.current++;
+                return true;
+            }
+            return is_numeric(*cursor.current);
+        };
+        if (next_component()) {
+            field = cursor.current;
+            if (!parse_checked_digits(cursor, 2, minute))
+                return cursor.result;
+            if (minute > 59)
+                return fail(parse_error::invalid_minute, field);
+            if (next_component()) {
+                field = cursor.current;
+                if (!parse_checked_digits(cursor, 2, second))
+                    return cursor.result;
+                if (second > 59)
+                    return fail(parse_error::invalid_second, field);
+                if (cursor.current != cursor.end && (*cursor.current == '.' || *cursor.current == ',')) {
+                    cursor.current++;
+                    int fraction = 0, digits = 0;
+                    if (!parse_checked_digit_run(cursor, 9, parse_error::invalid_microsecond, fraction, digits))
+                        return cursor.result;
+                    microsecond = digits <= 6 ? fraction * pow10_table[6 - digits] : fraction / pow10_table[digits - 6];
+                }
+            }
+        }
+
+        if (cursor.current != cursor.end) {
+            const char sign = *cursor.current;
+            if (sign == 'Z' || sign == 'z') {
+                cursor.current++;
+            } else if (sign == '+' || sign == '-') {
+                cursor.current++;
+                int offset_hours = 0, offset_mins = 0;
+                field = cursor.current;
+                if (!parse_checked_digits(cursor, 2, offset_hours))
+                    return cursor.result;
+                if (next_component() && !parse_checked_digits(cursor, 2, offset_mins))
+                    return cursor.result;
+                if (offset_hours > 23 || offset_mins > 59)
+                    return fail(parse_error::invalid_offset, field);
+                offset_minutes = (offset_hours * 60 + offset_mins) * (sign == '-' ? -1 : 1);
+            }
+        }
+    }
+    if (cursor.current != cursor.end)
+        return fail(parse_error::trailing_characters, cursor.current);
+
+    const long long seconds_of_day = hour * 3600LL + minute * 60LL + second - offset_minutes * 60LL;
+    out = days_from_civil(year, month, day) * DATETIME_MICROSECONDS_PER_DAY + seconds_of_day * 1000000LL + microsecond;
+    return {};
+}
+
+/**
+ * Writes the datetime as ISO 8601 / RFC 3339, e.g. "2024-06-10T12:34:56.123Z" or "2024-06-10T18:04:56+05:30".
+ * Years past 9999 are written with all their digits.
+ *
+ * @param date The datetime in UTC.
+ * @param out The output buffer, at least DATETIME_ISO8601_CAPACITY + 1 characters.
+ * @param format The fraction digits, offset and style to write.
+ * @return The number of characters written, not counting the terminator, 0 and an empty string if the offset is
+ * beyond +-23:59.
+ */
+inline int format_iso8601(datetime date, char *out, const iso8601_format &format = {}) {
+    if (format.offset_minutes < -DATETIME_ISO8601_MAX_OFFSET || format.offset_minutes > DATETIME_ISO8601_MAX_OFFSET) {
+        end_string(out);
+        return 0;
+    }
+    const long long local = date.data + format.offset_minutes * 60000000LL;
+    const int days = datetime_day_number(local);
+    int year = 0, month = 0, day = 0;
+    civil_from_days(days, year, month, day);
+    const long long time_of_day = local - days * DATETIME_MICROSECONDS_PER_DAY;
+    const int seconds = static_cast<int>(time_of_day / 1000000LL);
+    const int microsecond = static_cast<int>(time_of_day % 1000000LL);
+
+    char *p = out;
+    const int year_digits = year > -10000 && year < 10000 ? 4 : datetime_digits(year);
+    datetime_put_year(p, year_digits, year);
+    p += year_digits + (year < 0);
+    if (!format.basic)
+        *p++ = '-';
+    datetime_put_pair(p, month);
+    p += 2;
+    if (!format.basic)
+        *p++ = '-';
+    datetime_put_pair(p, day);
+    p += 2;
+    *p++ = format.separator;
+    datetime_put_pair(p, seconds / 3600);
+    p += 2;
+    if (!format.basic)
+        *p++ = ':';
+    datetime_put_pair(p, seconds % 3600 / 60);
+    p += 2;
+    if (!format.basic)
+        *p++ = ':';
+    datetime_put_pair(p, seconds % 60);
+    p += 2;
+    if (format.fraction_digits > 0) {
+        const int digits = format.fraction_digits < 9 ? format.fraction_digits : 9;
+        *p++ = '.';
+        datetime_put_microsecond(p, digits, microsecond);
+        p += digits;
+    }
+    if (format.offset_minutes == 0 && format.utc_as_z) {
+        *p++ = 'Z';
+    } else {
+        const int offset = format.offset_minutes < 0 ? -format.offset_minutes : format.offset_minutes;
+        *p++ = format.offset_minutes < 0 ? '-' : '+';
+        datetime_put_pair(p, offset / 60);
+        p += 2;
+        if (!format.basic)
+            *p++ = ':';
+        datetime_put_pair(p, offset % 60);
+        p += 2;
+    }
+    end_string(p);
+    return static_cast<int>(p - out);
+}
+
+/**
+ * @brief Writes the datetime as ISO 8601 / RFC 3339 into an inline string.
+ */
+inline datetime_string<DATETIME_ISO8601_CAPACITY> to_iso8601_string(datetime date, const iso8601_format &format = {}) {
+    datetime_string<DATETIME_ISO8601_CAPACITY> result;
+    result.length = format_iso8601(date, result.buffer, format);
+    return result;
+}
+} // namespace gtr
+#endif
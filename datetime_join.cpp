@@ -0,0 +1,36 @@
+#include "datetime_join.h"
+#include <thread>
+#include <vector>
+namespace gtr {
+
+// Below this many left times per thread the threads cost more than they save
+constexpr long long DATETIME_JOIN_MIN_PARTITION = 1 << 16;
+
+long long asof_join_parallel(const datetime *left, long long left_count, const datetime *right, long long right_count, long long *out,
+                             const asof_options &options, int threads) {
+    if (threads <= 0)
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    const long long most = left_count / DATETIME_JOIN_MIN_PARTITION;
+    if (threads > most)
+        threads = static_cast<int>(most);
+    if (threads <= 1)
+        return asof_join(left, left_count, right, right_count, out, options);
+
+    std::vector<long long> matched(static_cast<size_t>(threads), 0);
+    std::vector<std::thread> workers;
+    const long long partition = (left_count + threads - 1) / threads;
+    for (int t = 0; t < threads; t++) {
+        const long long first = t * partition;
+        const long long count = left_count - first < partition ? left_count - first : partition;
+        workers.emplace_back([=, &matched, &options] {
+            matched[static_cast<size_t>(t)] = asof_join(left + first, count, right, right_count, out + first, options);
+        });
+    }
+    long long total = 0;
+    for (int t = 0; t < threads; t++) {
+        workers[static_cast<size_t>(t)].join();
+        total += matched[static_cast<size_t>(t)];
+    }
+    return total;
+}
+} // namespace gtr
@@ -0,0 +1,78 @@
+#ifndef DATETIME_JOIN_H
+#define DATETIME_JOIN_H
+#include "datetime_index.h"
+
+// As-of join of two sorted series: each left time is matched with the right time prevailing at, following or nearest
+// to it. Both series are walked once, the right one by galloping so a sparse left series skips over dense right runs.
+namespace gtr {
+
+/**
+ * @brief Which right time a left time is matched with.
+ */
+enum class asof_direction {
+    backward, /**< The last right time at or before the left time. */
+    forward,  /**< The first right time at or after the left time. */
+    nearest,  /**< The closer of the two, backward on a tie. */
+};
+
+/**
+ * @brief The options of an as-of join.
+ */
+struct asof_options {
+    asof_direction direction{asof_direction::backward};
+    datetime tolerance{-1}; /**< The largest gap matched, in microseconds, negative for no limit. */
+};
+
+/**
+ * @brief Joins each left time with a right time.
+ * @param left The left times, sorted.
+ * @param right The right times, sorted.
+ * @param out Receives for each left time the position of its right time, -1 when there is none within the tolerance.
+ *            Among equal right times backward matches the last, forward the first.
+ * @return The number of left times matched.
+ */
+inline long long asof_join(const datetime *left, long long left_count, const datetime *right, long long right_count, long long *out,
+                           const asof_options &options = {}) {
+    constexpr long long max_time = 9223372036854775807LL;
+    const bool limited = options.tolerance.data >= 0;
+    const unsigned long long tolerance = static_cast<unsigned long long>(options.tolerance.data);
+    long long matched = 0;
+    // The first right time not before the previous left time, the left times only move it forward
+    long long first_not_before = 0;
+    for (long long i = 0; i < left_count; i++) {
+        const long long time = left[i].data;
+        first_not_before = gallop_lower_bound(right, right_count, first_not_before, time);
+        long long match = -1;
+        unsigned long long gap = 0; // unsigned so extreme times cannot overflow
+        if (options.direction != asof_direction::forward) {
+            const long long first_after = time == max_time ? right_count : gallop_lower_bound(right, right_count, first_not_before, time + 1);
+            if (first_after > 0) {
+                match = first_after - 1;
+                gap = static_cast<unsigned long long>(time) - static_cast<unsigned long long>(right[match].data);
+            }
+        }
+        if (options.direction != asof_direction::backward && first_not_before < right_count) {
+            const unsigned long long forward_gap = static_cast<unsigned long long>(right[first_not_before].data) - static_cast<unsigned long long>(time);
+            if (match < 0 || forward_gap < gap) {
+                match = first_not_before;
+                gap = forward_gap;
+            }
+        }
+        if (match >= 0 && limited && gap > tolerance)
+            match = -1;
+        out[i] = match;
+        matched += match >= 0;
+    }
+    return matched;
+}
+
+/**
+ * @brief Joins like asof_join, splitting the left times between threads.
+ *
+ * Each thread joins a contiguous part of the left times, finding its start in the right times by galloping.
+ * @param threads The number of threads, 0 for std::thread::hardware_concurrency.
+ */
+long long asof_join_parallel(const datetime *left, long long left_count, const datetime *right, long long right_count, long long *out,
+                             const asof_options &options = {}, int threads = 0);
+} // namespace gtr
+#endif
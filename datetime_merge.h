@@ -0,0 +1,172 @@
+#ifndef DATETIME_MERGE_H
+#define DATETIME_MERGE_H
+#include "datetime.h"
+#include <vector>
+
+// Merges time-sorted sources into one timeline with a loser tree: every internal node keeps the loser of the
+// match played there, so replacing the winner replays a single leaf to root path of log2(N) comparisons,
+// against about twice that for a binary heap. Ties are broken by source, lower first, so the merge is stable.
+namespace gtr {
+
+/**
+ * @brief A window of sorted times, refilled from a pull-based source when consumed.
+ */
+struct merge_source {
+    const datetime *begin{nullptr};
+    const datetime *end{nullptr};
+    /**
+     * Called when the window is consumed, sets the next window and returns false at the end of the source.
+     * Null for sources held entirely in memory.
+     */
+    bool (*refill)(void *context, const datetime *&begin, const datetime *&end){nullptr};
+    void *context{nullptr};
+};
+
+/**
+ * @brief A source over a sorted array held in memory.
+ */
+inline merge_source span_source(const datetime *sorted, long long count) { return {sorted, sorted + count, nullptr, nullptr}; }
+
+/**
+ * @brief One merged time, with its source and its position in that source.
+ */
+struct merge_item {
+    datetime time;
+    int source{0};
+    long long position{0};
+};
+
+/**
+ * Merges any number of sorted sources, allocating only when constructed.
+ */
+class time_merger {
+  public:
+    time_merger() = default;
+
+    /**
+     * @brief Starts merging, the sources are copied, the arrays they point to are not.
+     */
+    time_merger(const merge_source *sources, int count) { reset(sources, count); }
+
+    /**
+     * @brief Starts merging new sources.
+     */
+    inline void reset(const merge_source *sources, int count) {
+        leaves_ = 1;
+        while (leaves_ < count) leaves_ *= 2;
+        sources_.assign(sources, sources + count);
+        positions_.assign(static_cast<size_t>(count), 0);
+        keys_.assign(static_cast<size_t>(leaves_), 0);
+        ties_.assign(static_cast<size_t>(leaves_), 0);
+        tree_.assign(static_cast<size_t>(leaves_), 0);
+        for (int leaf = 0; leaf < leaves_; leaf++) {
+            if (leaf < count && (sources_[static_cast<size_t>(leaf)].begin != sources_[static_cast<size_t>(leaf)].end ||
+                                 refill(sources_[static_cast<size_t>(leaf)])))
+                load(leaf);
+            else
+                exhaust(leaf);
+        }
+        tree_[0] = build(1);
+    }
+
+    /**
+     * @brief Returns true once every source is consumed.
+     */
+    inline bool done() const { return sources_.empty() || ties_[static_cast<size_t>(tree_[0])] >= leaves_; }
+
+    /**
+     * @brief Writes the next merged items in time order.
+     * @return The number of items written, less than capacity only at the end of the merge.
+     */
+    inline long long next(merge_item *out, long long capacity) {
+        return drain(capacity, [out](long long index, datetime time, int source, long long position) {
+            out[index] = {time, source, position};
+        });
+    }
+
+    /**
+     * @brief Writes the next merged times only.
+     */
+    inline long long next(datetime *out, long long capacity) {
+        return drain(capacity, [out](long long index, datetime time, int, long long) { out[index] = time; });
+    }
+
+  private:
+    std::vector<merge_source> sources_;
+    std::vector<long long> positions_;
+    std::vector<long long> keys_; // the next time of each leaf
+    std::vector<int> ties_;       // breaks equal keys: the leaf, plus leaves_ once exhausted so live leaves win
+    std::vector<int> tree_;       // the loser of each match, tree_[0] the overall winner
+    int leaves_{1};
+
+    template <class Emit> inline long long drain(long long capacity, Emit emit) {
+        if (sources_.empty())
+            return 0;
+        int winner = tree_[0];
+        long long written = 0;
+        while (written < capacity && ties_[static_cast<size_t>(winner)] < leaves_) {
+            merge_source &source = sources_[static_cast<size_t>(winner)];
+            emit(written++, keys_[static_cast<size_t>(winner)], winner, positions_[static_cast<size_t>(winner)]++);
+            if (++source.begin != source.end || refill(source))
+                keys_[static_cast<size_t>(winner)] = source.begin->data;
+            else
+                exhaust(winner);
+            winner = replay(winner);
+        }
+        tree_[0] = winner;
+        return written;
+    }
+
+    static inline bool refill(merge_source &source) {
+        while (source.refill != nullptr) {
+            if (!source.refill(source.context, source.begin, source.end)) {
+                source.refill = nullptr;
+                break;
+            }
+            if (source.begin != source.end)
+                return true;
+        }
+        source.begin = source.end;
+        return false;
+    }
+
+    inline void load(int leaf) {
+        keys_[static_cast<size_t>(leaf)] = sources_[static_cast<size_t>(leaf)].begin->data;
+        ties_[static_cast<size_t>(leaf)] = leaf;
+    }
+
+    inline void exhaust(int leaf) {
+        keys_[static_cast<size_t>(leaf)] = 9223372036854775807LL;
+        ties_[static_cast<size_t>(leaf)] = leaf + leaves_;
+    }
+
+    inline bool before(int a, int b) const {
+        const long long key_a = keys_[static_cast<size_t>(a)], key_b = keys_[static_cast<size_t>(b)];
+        return key_a < key_b || (key_a == key_b && ties_[static_cast<size_t>(a)] < ties_[static_cast<size_t>(b)]);
+    }
+
+    // Plays the matches below node, storing the losers, and returns the winner
+    inline int build(int node) {
+        if (node >= leaves_)
+            return node - leaves_;
+        const int left = build(2 * node), right = build(2 * node + 1);
+        const bool left_wins = before(left, right);
+        tree_[static_cast<size_t>(node)] = left_wins ? right : left;
+        return left_wins ? left : right;
+    }
+
+    // Replays the path of a leaf whose key changed, returns the new winner
+    inline int replay(int leaf) {
+        int winner = leaf;
+        for (int node = (leaf + leaves_) >> 1; node > 0; node >>= 1) {
+            const int loser = tree_[static_cast<size_t>(node)];
+            if (before(loser, winner)) {
+                tree_[static_cast<size_t>(node)] = winner;
+                winner = loser;
+            }
+        }
+        return winner;
+    }
+};
+} // namespace gtr
+#endif
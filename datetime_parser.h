@@ -1,6 +1,7 @@
 #ifndef DATETIME_PARSER_H
 #define DATETIME_PARSER_H
 #include "datetime.h"
+#include "datetime_calendar.h"
 #ifdef _WIN32
 #pragma warning(push)
 #pragma warning(disable : 4244)
@@ -11,18 +12,105 @@ constexpr inline bool is_numeric(char a) { return a >= '0' && a <= '9'; }
 
 constexpr inline void end_string(char *s) { *s = '\0'; }
 constexpr const char *datetime_month_abbrev[]{"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+constexpr const char *datetime_month_names[]{"January", "February", "March",     "April",   "May",      "June",
+                                             "July",    "August",   "September", "October", "November", "December"};
+constexpr const char *datetime_weekday_abbrev[]{"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+constexpr const char *datetime_weekday_names[]{"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+
+// The first three letters packed in 32 bits, lower case when they are ASCII letters
+constexpr inline unsigned int datetime_name_key(const char *name) {
+    return (static_cast<unsigned int>(static_cast<unsigned char>(name[0])) |
+            static_cast<unsigned int>(static_cast<unsigned char>(name[1])) << 8 |
+            static_cast<unsigned int>(static_cast<unsigned char>(name[2])) << 16) |
+           0x202020U;
+}
+
+// Multiplicative perfect hash of the first three letters of a set of names
+template <int Count, int Bits> struct datetime_name_hash {
+    unsigned int multiplier;
+    unsigned int keys[1 << Bits];
+    unsigned char values[1 << Bits];
+
+    constexpr datetime_name_hash(const char *const (&names)[Count], unsigned int hash_multiplier)
+        : multiplier(hash_multiplier), keys{}, values{} {
+        for (int i = 0; i < Count; i++) {
+            const unsigned int key = datetime_name_key(names[i]);
+            keys[slot(key)] = key;
+            values[slot(key)] = static_cast<unsigned char>(i + 1);
+        }
+    }
+
+    constexpr unsigned int slot(unsigned int key) const { return (key * multiplier) >> (32 - Bits); }
+
+    // Returns the 1 based index of the name, 0 when unknown. Empty slots hold key 0 which never matches
+    constexpr int find(const char *name) const {
+        const unsigned int key = datetime_name_key(name);
+        const unsigned int index = slot(key);
+        return keys[index] == key ? values[index] : 0;
+    }
+
+    constexpr bool is_perfect(const char *const (&names)[Count]) const {
+        for (int i = 0; i < Count; i++) {
+            if (find(names[i]) != i + 1)
+                return false;
+        }
+        return true;
+    }
+};
+
+// Multipliers found by exhaustive search
+inline constexpr datetime_name_hash<12, 4> datetime_month_hash{datetime_month_abbrev, 1304659205U};
+inline constexpr datetime_name_hash<7, 3> datetime_weekday_hash{datetime_weekday_abbrev, 1627191775U};
+static_assert(datetime_month_hash.is_perfect(datetime_month_abbrev), "month hash has collisions");
+static_assert(datetime_weekday_hash.is_perfect(datetime_weekday_abbrev), "weekday hash has collisions");
+
+// Full names padded to a fixed width so they are written with a single fixed size copy
+constexpr int DATETIME_NAME_WIDTH = 9;
+struct datetime_name {
+    char text[DATETIME_NAME_WIDTH];
+    int length;
+};
+
+template <int Count> struct datetime_name_table {
+    datetime_name names[Count];
+
+    constexpr datetime_name_table(const char *const (&source)[Count]) : names{} {
+        for (int i = 0; i < Count; i++) {
+            int length = 0;
+            while (source[i][length] != '\0') length++;
+            for (int c = 0; c < DATETIME_NAME_WIDTH; c++) names[i].text[c] = c < length ? source[i][c] : ' ';
+            names[i].length = length;
+        }
+    }
+};
+
+inline constexpr datetime_name_table<12> datetime_month_name_table{datetime_month_names};
+inline constexpr datetime_name_table<7> datetime_weekday_name_table{datetime_weekday_names};
+
+inline int datetime_month_from_name(const char *name) { return datetime_month_hash.find(name); }
+
+inline int datetime_weekday_from_name(const char *name) { return datetime_weekday_hash.find(name) - 1; }
 
-inline int datetime_get_month_from_sum(int sum) {
-    static constexpr const int char_sum[] = {281, 269, 288, 291, 295, 301, 299, 401, 296, 294, 307, 268};
-    int month = 1;
-    while (char_sum[month - 1] != sum) month++;
-    return month;
+inline void datetime_put_abbrev(char *dest, const char *name) {
+    dest[0] = name[0];
+    dest[1] = name[1];
+    dest[2] = name[2];
 }
 
-inline void datetime_strcpy(char *dest, const char *source) {
-    do {
-        *dest++ = *source++;
-    } while (*source != '\0');
+// Writes DATETIME_NAME_WIDTH characters, the caller advances by the name length
+inline void datetime_put_name(char *dest, const datetime_name &name) {
+    for (int i = 0; i < DATETIME_NAME_WIDTH; i++) dest[i] = name.text[i];
+}
+
+// Case insensitive match of a full name whose first three letters are already known to match
+inline bool datetime_name_matches(const char *input, const char *end, const datetime_name &name) {
+    if (end - input < name.length)
+        return false;
+    for (int i = 3; i < name.length; i++) {
+        if ((input[i] | 0x20) != (name.text[i] | 0x20))
+            return false;
+    }
+    return true;
 }
 
 inline int datetime_atoi(const char *buffer) {
@@ -50,20 +138,25 @@ inline int datetime_digits(int number) {
     return 10;
 }
 
+// "00".."99" laid out back to back so any two digit number is a single two byte copy
+constexpr char datetime_digit_pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+inline void datetime_put_pair(char *dest, int number) {
+    dest[0] = datetime_digit_pairs[number * 2];
+    dest[1] = datetime_digit_pairs[number * 2 + 1];
+}
+
 inline void datetime_put_hour(char *dest, int digits, int number) {
-    if (number < 10) {
-        // Trailing zero
-        if (digits == 2) {
-            *dest++ = '0';
-        }
-        *dest++ = char('0' + number);
+    if (digits == 2) {
+        datetime_put_pair(dest, number);
     } else {
-        *dest++ = char('0' + number / 10);
-        if (digits >= 2) {
-            *dest++ = char('0' + number % 10);
-        }
+        *dest = char('0' + number % 10);
     }
-    end_string(dest);
 }
 
 inline void datetime_put_month(char *dest, int digits, int number) { return datetime_put_hour(dest, digits, number); }
@@ -76,45 +169,162 @@ inline void datetime_put_second(char *dest, int digits, int number) { return dat
 
 static constexpr int pow10_table[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
 
+// Writes the last `digits` digits of the year, zero padded
 inline void datetime_put_year(char *dest, int digits, int number) {
     if (number < 0) {
         *dest++ = '-';
         number = -number;
     }
-
-    int year_digits = datetime_digits(number);
-    int start = year_digits - digits;
-    if (start < 0) {
-        start = 0;
+    if (digits == 4) {
+        datetime_put_pair(dest, number / 100 % 100);
+        datetime_put_pair(dest + 2, number % 100);
+        return;
     }
-    for (int i = start; i < year_digits; i++) {
-        int div = pow10_table[year_digits - i - 1];
-        *dest++ = char('0' + number / div);
-        number %= div;
+    if (digits == 2) {
+        datetime_put_pair(dest, number % 100);
+        return;
     }
-    end_string(dest);
+    // Back to front, two digits at a time
+    dest += digits;
+    while (digits >= 2) {
+        dest -= 2;
+        datetime_put_pair(dest, number % 100);
+        number /= 100;
+        digits -= 2;
+    }
+    if (digits == 1)
+        *--dest = char('0' + number % 10);
 }
 
+// Writes the first `digits` digits of the six digit microsecond
 inline void datetime_put_microsecond(char *dest, int digits, int number) {
-    int microsecond_digits = datetime_digits(number);
-    int digits_to_write = digits;
-    if (microsecond_digits < 6) {
-        // Trailing zeros
-        for (int i = 0; i < 6 - microsecond_digits && i < digits_to_write; i++) {
-            *dest++ = '0';
-            digits_to_write--;
-        }
+    if (digits >= 6) {
+        datetime_put_pair(dest, number / 10000);
+        datetime_put_pair(dest + 2, number / 100 % 100);
+        datetime_put_pair(dest + 4, number % 100);
+        // Anything past microsecond precision is zero
+        for (int i = 6; i < digits; i++) dest[i] = '0';
+        return;
     }
-    for (int i = 0; i < digits_to_write; i++) {
-        int div = pow10_table[microsecond_digits - i - 1];
-        *dest++ = static_cast<char>('0' + number / div);
-        number %= div;
+    char buffer[6];
+    datetime_put_pair(buffer, number / 10000);
+    datetime_put_pair(buffer + 2, number / 100 % 100);
+    datetime_put_pair(buffer + 4, number % 100);
+    for (int i = 0; i < digits; i++) dest[i] = buffer[i];
+}
+
+// State of a checked parse, never reads at or past end
+struct parse_cursor {
+    const char *begin;
+    const char *current;
+    const char *end;
+    const char *day_position; // the day is checked once month and year are known
+    parse_result result;
+
+    inline bool fail(parse_error error, const char *at) {
+        result = {error, static_cast<int>(at - begin)};
+        return false;
     }
-    end_string(dest);
+};
+
+inline parse_cursor make_parse_cursor(const char *date, int length) { return {date, date, date + length, nullptr, {}}; }
+
+// Defaults for the fields missing from a checked format
+inline datetime_struct make_checked_pack() {
+    datetime_struct pack{};
+    pack.day = 1;
+    pack.month = 1;
+    pack.year = 1970;
+    return pack;
+}
+
+inline bool parse_checked_digits(parse_cursor &cursor, int count, int &value) {
+    if (cursor.end - cursor.current < count)
+        return cursor.fail(parse_error::unexpected_end, cursor.end);
+    int result = 0;
+    for (int i = 0; i < count; i++) {
+        const unsigned int digit = static_cast<unsigned int>(static_cast<unsigned char>(cursor.current[i])) - '0';
+        if (digit > 9)
+            return cursor.fail(parse_error::expected_digit, cursor.current + i);
+        result = result * 10 + static_cast<int>(digit);
+    }
+    cursor.current += count;
+    value = result;
+    return true;
+}
+
+// Reads one up to max_digits digits and fails if a further digit follows
+inline bool parse_checked_digit_run(parse_cursor &cursor, int max_digits, parse_error too_long, int &value, int &digits) {
+    const char *field = cursor.current;
+    int result = 0;
+    digits = 0;
+    while (cursor.current != cursor.end && is_numeric(*cursor.current)) {
+        if (digits == max_digits)
+            return cursor.fail(too_long, field);
+        result = result * 10 + (*cursor.current++ - '0');
+        digits++;
+    }
+    if (digits == 0)
+        return cursor.fail(cursor.current == cursor.end ? parse_error::unexpected_end : parse_error::expected_digit, cursor.current);
+    value = result;
+    return true;
+}
+
+// Checks the input is consumed and the day exists in the parsed month
+inline bool parse_checked_finish(parse_cursor &cursor, const datetime_struct &pack) {
+    if (cursor.current != cursor.end)
+        return cursor.fail(parse_error::trailing_characters, cursor.current);
+    if (cursor.day_position != nullptr && pack.day > datetime::month_day_count(pack.month, pack.year))
+        return cursor.fail(parse_error::invalid_day, cursor.day_position);
+    return true;
+}
+
+inline bool datetime_pack_in_range(const datetime_struct &pack) {
+    return pack.year >= 1 && pack.year <= 290000 && pack.month >= 1 && pack.month <= 12 && pack.day >= 1 &&
+           pack.day <= datetime::month_day_count(pack.month, pack.year) && pack.hour <= 23 && pack.minute <= 59 && pack.second <= 59;
+}
+
+// Converts digits already known to be valid
+template <int Count> inline int datetime_fixed_digits(const char *digits) {
+    int value = 0;
+    for (int i = 0; i < Count; i++) value = value * 10 + (digits[i] - '0');
+    return value;
+}
+
+// Sets the high bit of every byte of the word holding an ASCII digit
+constexpr inline unsigned long long datetime_swar_digit_flags(unsigned long long word) {
+    constexpr unsigned long long low_bits = 0x7F7F7F7F7F7F7F7FULL;
+    constexpr unsigned long long high_bits = 0x8080808080808080ULL;
+    const unsigned long long shifted = word ^ 0x3030303030303030ULL; // digits become 0 - 9
+    const unsigned long long not_digit = (((shifted & low_bits) + 0x7676767676767676ULL) | shifted) & high_bits;
+    return not_digit ^ high_bits;
+}
+
+// Loads 8 bytes, first byte in the lowest bits
+inline unsigned long long datetime_swar_load(const char *bytes) {
+    unsigned long long word = 0;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    __builtin_memcpy(&word, bytes, 8);
+#else
+    for (int i = 0; i < 8; i++) word |= static_cast<unsigned long long>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+#endif
+    return word;
+}
+
+// Converts a word of 8 ASCII digits, first digit in the lowest byte, by combining pairs, then quads, then halves
+constexpr inline unsigned int datetime_swar_eight_digits(unsigned long long word) {
+    word -= 0x3030303030303030ULL;
+    word = (word * 10 + (word >> 8)) & 0x00FF00FF00FF00FFULL;
+    word = (word * 100 + (word >> 16)) & 0x0000FFFF0000FFFFULL;
+    return static_cast<unsigned int>((word * 10000 + (word >> 32)) & 0xFFFFFFFFULL);
 }
 
 enum year_format { year_four, year_two, year_all };
 template <year_format Format = year_format::year_four> struct year_field {
+    static constexpr int max_size = Format == year_four ? 5 : Format == year_two ? 3 : 7;
+    static constexpr int fixed_size = Format == year_four ? 4 : Format == year_two ? 2 : -1;
+    static constexpr char layout = 'd';
+
     static inline int parse(const char **state, datetime_struct &pack) {
         char buffer[8] = {};
         int index = 0;
@@ -126,6 +336,27 @@ template <year_format Format = year_format::year_four> struct year_field {
         return index;
     }
 
+    static inline bool parse_checked(parse_cursor &cursor, datetime_struct &pack) {
+        const char *field = cursor.current;
+        int value = 0, digits = 0;
+        if constexpr (Format == year_all) {
+            if (!parse_checked_digit_run(cursor, 6, parse_error::invalid_year, value, digits))
+                return false;
+        } else if (!parse_checked_digits(cursor, fixed_size, value)) {
+            return false;
+        }
+        if (value < 1 || value > 290000)
+            return cursor.fail(parse_error::invalid_year, field);
+        pack.year = value;
+        return true;
+    }
+
+    // Parses a layout validated field
+    static inline bool parse_fixed(const char *date, datetime_struct &pack) {
+        pack.year = datetime_fixed_digits<fixed_size>(date);
+        return true;
+    }
+
     // Puts using format
     static inline void puts(const char **format, char **out, datetime_struct &pack) {
         if (*(++*format) == 'Y') {
@@ -170,6 +401,31 @@ template <year_format Format = year_format::year_four> struct year_field {
 };
 
 struct day_field {
+    static constexpr int max_size = 2;
+    static constexpr int fixed_size = 2;
+    static constexpr char layout = 'd';
+
+    static inline bool parse_checked(parse_cursor &cursor, datetime_struct &pack) {
+        const char *field = cursor.current;
+        int value = 0;
+        if (!parse_checked_digits(cursor, 2, value))
+            return false;
+        if (value < 1 || value > 31)
+            return cursor.fail(parse_error::invalid_day, field);
+        cursor.day_position = field;
+        pack.day = value;
+        return true;
+    }
+
+    static inline bool parse_fixed(const char *date, datetime_struct &pack) {
+        // Checked before the store, the bitfield would wrap
+        const int value = datetime_fixed_digits<2>(date);
+        if (value < 1 || value > 31)
+            return false;
+        pack.day = value;
+        return true;
+    }
+
     static inline int parse(const char **state, datetime_struct &pack) {
         char buffer[8];
         buffer[0] = *(*state)++;
@@ -194,15 +450,25 @@ struct day_field {
 };
 
 template <month_format Format = month_format::month_digits> struct month_field {
+    static constexpr int max_size = Format == month_format::month_digits ? 2 : Format == month_format::month_abbrev ? 3 : DATETIME_NAME_WIDTH;
+    static constexpr int fixed_size = Format == month_format::month_digits ? 2 : Format == month_format::month_abbrev ? 3 : -1;
+    // Names are matched by parse_fixed instead of the digit layout check
+    static constexpr char layout = Format == month_format::month_digits ? 'd' : 'a';
+
     static inline int parse(const char **state, datetime_struct &pack);
+    static inline bool parse_checked(parse_cursor &cursor, datetime_struct &pack);
+    static inline bool parse_fixed(const char *date, datetime_struct &pack);
     static inline void puts(const char **format, char **out, datetime_struct &pack);
     static inline void puts(char **out, datetime_struct &pack);
 };
 
 template <month_format Format> inline void month_field<Format>::puts(const char **format, char **out, datetime_struct &pack) {
-    datetime_strcpy(*out, datetime_month_abbrev[pack.month - 1]);
-    *format += 3;
-    *out += 3;
+    if constexpr (Format == month_format::month_abbrev) {
+        *format += 3;
+    } else {
+        *format += 4;
+    }
+    puts(out, pack);
 }
 
 template <> inline void month_field<month_format::month_digits>::puts(const char **format, char **out, datetime_struct &pack) {
@@ -212,8 +478,14 @@ template <> inline void month_field<month_format::month_digits>::puts(const char
 }
 
 template <month_format Format> inline void month_field<Format>::puts(char **out, datetime_struct &pack) {
-    datetime_strcpy(*out, datetime_month_abbrev[pack.month - 1]);
-    *out += 3;
+    if constexpr (Format == month_format::month_abbrev) {
+        datetime_put_abbrev(*out, datetime_month_abbrev[pack.month - 1]);
+        *out += 3;
+    } else {
+        const datetime_name &name = datetime_month_name_table.names[pack.month - 1];
+        datetime_put_name(*out, name);
+        *out += name.length;
+    }
 }
 
 template <> inline void month_field<month_format::month_digits>::puts(char **out, datetime_struct &pack) {
@@ -230,13 +502,155 @@ template <> inline int month_field<month_format::month_digits>::parse(const char
     return 2;
 }
 
+// Returns the length of the format token, unknown names leave month 0
 template <month_format Format> inline int month_field<Format>::parse(const char **state, datetime_struct &pack) {
-    pack.month = datetime_get_month_from_sum((*state)[0] + (*state)[1] + (*state)[2]);
-    (*state) += 3;
-    return 3;
+    const int month = datetime_month_from_name(*state);
+    pack.month = month;
+    if constexpr (Format == month_format::month_abbrev) {
+        (*state) += 3;
+        return 3;
+    } else {
+        (*state) += month != 0 ? datetime_month_name_table.names[month - 1].length : 3;
+        return 4;
+    }
 }
 
+template <> inline bool month_field<month_format::month_digits>::parse_checked(parse_cursor &cursor, datetime_struct &pack) {
+    const char *field = cursor.current;
+    int value = 0;
+    if (!parse_checked_digits(cursor, 2, value))
+        return false;
+    if (value < 1 || value > 12)
+        return cursor.fail(parse_error::invalid_month, field);
+    pack.month = value;
+    return true;
+}
+
+template <month_format Format> inline bool month_field<Format>::parse_checked(parse_cursor &cursor, datetime_struct &pack) {
+    if (cursor.end - cursor.current < 3)
+        return cursor.fail(parse_error::unexpected_end, cursor.end);
+    const int month = datetime_month_from_name(cursor.current);
+    if (month == 0)
+        return cursor.fail(parse_error::invalid_month, cursor.current);
+    if constexpr (Format == month_format::month_name) {
+        const datetime_name &name = datetime_month_name_table.names[month - 1];
+        if (!datetime_name_matches(cursor.current, cursor.end, name))
+            return cursor.fail(parse_error::invalid_month, cursor.current);
+        cursor.current += name.length;
+    } else {
+        cursor.current += 3;
+    }
+    pack.month = month;
+    return true;
+}
+
+template <> inline bool month_field<month_format::month_digits>::parse_fixed(const char *date, datetime_struct &pack) {
+    // Checked before the store, the bitfield would wrap
+    const int value = datetime_fixed_digits<2>(date);
+    if (value < 1 || value > 12)
+        return false;
+    pack.month = value;
+    return true;
+}
+
+// Unknown names leave month 0, which fails the range check
+template <month_format Format> inline bool month_field<Format>::parse_fixed(const char *date, datetime_struct &pack) {
+    pack.month = datetime_month_from_name(date);
+    return true;
+}
+
+/**
+ * @brief The format options for weekday names.
+ */
+enum class weekday_format { weekday_abbrev, weekday_name };
+
+// The weekday follows from the date, so parsing only checks and skips the name
+template <weekday_format Format = weekday_format::weekday_abbrev> struct weekday_field {
+    static constexpr int max_size = Format == weekday_format::weekday_abbrev ? 3 : DATETIME_NAME_WIDTH;
+    static constexpr int fixed_size = Format == weekday_format::weekday_abbrev ? 3 : -1;
+    static constexpr char layout = 'a';
+
+    // Returns the length of the format token
+    static inline int parse(const char **state, datetime_struct &pack) {
+        (void)pack;
+        if constexpr (Format == weekday_format::weekday_abbrev) {
+            (*state) += 3;
+            return 3;
+        } else {
+            const int weekday = datetime_weekday_from_name(*state);
+            (*state) += weekday >= 0 ? datetime_weekday_name_table.names[weekday].length : 3;
+            return 4;
+        }
+    }
+
+    static inline bool parse_checked(parse_cursor &cursor, datetime_struct &pack) {
+        (void)pack;
+        if (cursor.end - cursor.current < 3)
+            return cursor.fail(parse_error::unexpected_end, cursor.end);
+        const int weekday = datetime_weekday_from_name(cursor.current);
+        if (weekday < 0)
+            return cursor.fail(parse_error::invalid_weekday, cursor.current);
+        if constexpr (Format == weekday_format::weekday_name) {
+            const datetime_name &name = datetime_weekday_name_table.names[weekday];
+            if (!datetime_name_matches(cursor.current, cursor.end, name))
+                return cursor.fail(parse_error::invalid_weekday, cursor.current);
+            cursor.current += name.length;
+        } else {
+            cursor.current += 3;
+        }
+        return true;
+    }
+
+    static inline bool parse_fixed(const char *date, datetime_struct &pack) {
+        (void)pack;
+        return datetime_weekday_from_name(date) >= 0;
+    }
+
+    // Puts using format
+    static inline void puts(const char **format, char **out, datetime_struct &pack) {
+        *format += Format == weekday_format::weekday_abbrev ? 3 : 4;
+        puts(out, pack);
+    }
+
+    // Puts using template argument
+    static inline void puts(char **out, datetime_struct &pack) {
+        const int weekday = day_of_week_from_days(days_from_civil(pack.year, pack.month, pack.day));
+        if constexpr (Format == weekday_format::weekday_abbrev) {
+            datetime_put_abbrev(*out, datetime_weekday_abbrev[weekday]);
+            *out += 3;
+        } else {
+            const datetime_name &name = datetime_weekday_name_table.names[weekday];
+            datetime_put_name(*out, name);
+            *out += name.length;
+        }
+    }
+};
+
 struct hour_field {
+    static constexpr int max_size = 2;
+    static constexpr int fixed_size = 2;
+    static constexpr char layout = 'd';
+
+    static inline bool parse_checked(parse_cursor &cursor, datetime_struct &pack) {
+        const char *field = cursor.current;
+        int value = 0;
+        if (!parse_checked_digits(cursor, 2, value))
+            return false;
+        if (value < 0 || value > 23)
+            return cursor.fail(parse_error::invalid_hour, field);
+        pack.hour = value;
+        return true;
+    }
+
+    static inline bool parse_fixed(const char *date, datetime_struct &pack) {
+        // Checked before the store, the bitfield would wrap
+        const int value = datetime_fixed_digits<2>(date);
+        if (value > 23)
+            return false;
+        pack.hour = value;
+        return true;
+    }
+
     static inline int parse(const char **state, datetime_struct &pack) {
         char buffer[8];
         buffer[0] = *(*state)++;
@@ -261,6 +675,30 @@ struct hour_field {
 };
 
 struct minute_field {
+    static constexpr int max_size = 2;
+    static constexpr int fixed_size = 2;
+    static constexpr char layout = 'd';
+
+    static inline bool parse_checked(parse_cursor &cursor, datetime_struct &pack) {
+        const char *field = cursor.current;
+        int value = 0;
+        if (!parse_checked_digits(cursor, 2, value))
+            return false;
+        if (value < 0 || value > 59)
+            return cursor.fail(parse_error::invalid_minute, field);
+        pack.minute = value;
+        return true;
+    }
+
+    static inline bool parse_fixed(const char *date, datetime_struct &pack) {
+        // Checked before the store, the bitfield would wrap
+        const int value = datetime_fixed_digits<2>(date);
+        if (value > 59)
+            return false;
+        pack.minute = value;
+        return true;
+    }
+
     static inline int parse(const char **state, datetime_struct &pack) {
         char buffer[8];
         buffer[0] = *(*state)++;
@@ -285,6 +723,30 @@ struct minute_field {
 };
 
 struct second_field {
+    static constexpr int max_size = 2;
+    static constexpr int fixed_size = 2;
+    static constexpr char layout = 'd';
+
+    static inline bool parse_checked(parse_cursor &cursor, datetime_struct &pack) {
+        const char *field = cursor.current;
+        int value = 0;
+        if (!parse_checked_digits(cursor, 2, value))
+            return false;
+        if (value < 0 || value > 59)
+            return cursor.fail(parse_error::invalid_second, field);
+        pack.second = value;
+        return true;
+    }
+
+    static inline bool parse_fixed(const char *date, datetime_struct &pack) {
+        // Checked before the store, the bitfield would wrap
+        const int value = datetime_fixed_digits<2>(date);
+        if (value > 59)
+            return false;
+        pack.second = value;
+        return true;
+    }
+
     static inline int parse(const char **state, datetime_struct &pack) {
         char buffer[8];
         buffer[0] = *(*state)++;
@@ -309,6 +771,24 @@ struct second_field {
 };
 
 template <int Digits = 1> struct microsecond_field {
+    static constexpr int max_size = Digits;
+    static constexpr int fixed_size = Digits <= 6 ? Digits : -1;
+    static constexpr char layout = 'd';
+
+    // Reads one to six digits regardless of Digits, like parse
+    static inline bool parse_checked(parse_cursor &cursor, datetime_struct &pack) {
+        int value = 0, digits = 0;
+        if (!parse_checked_digit_run(cursor, 6, parse_error::invalid_microsecond, value, digits))
+            return false;
+        pack.microsecond = value * pow10_table[6 - digits];
+        return true;
+    }
+
+    static inline bool parse_fixed(const char *date, datetime_struct &pack) {
+        pack.microsecond = datetime_fixed_digits<Digits>(date) * pow10_table[6 - Digits];
+        return true;
+    }
+
     static inline int parse(const char **state, datetime_struct &pack) {
         char buffer[8];
         int index = 0;
@@ -341,6 +821,29 @@ template <int Digits = 1> struct microsecond_field {
 };
 
 template <int Count = 1, char Sep = ':'> struct separator_field {
+    static constexpr int max_size = Count;
+    static constexpr int fixed_size = Count;
+    static constexpr char layout = 's';
+
+    // Separators only have to be something other than a digit, Sep is the character written by puts
+    static inline bool parse_checked(parse_cursor &cursor, datetime_struct &pack) {
+        (void)pack;
+        if (cursor.end - cursor.current < Count)
+            return cursor.fail(parse_error::unexpected_end, cursor.end);
+        for (int i = 0; i < Count; i++) {
+            if (is_numeric(cursor.current[i]))
+                return cursor.fail(parse_error::expected_separator, cursor.current + i);
+        }
+        cursor.current += Count;
+        return true;
+    }
+
+    static inline bool parse_fixed(const char *date, datetime_struct &pack) {
+        (void)date;
+        (void)pack;
+        return true;
+    }
+
     static inline int parse(const char **state, datetime_struct &pack) {
         (void)pack;
         (*state) += Count;
@@ -362,11 +865,41 @@ template <int Count = 1, char Sep = ':'> struct separator_field {
 
 #ifdef DATETIME_PERFECT_PARSER
 template <class... Args> struct perfect_parser {
+    static constexpr int max_size = (0 + ... + Args::max_size);
+
+    // Every field has a fixed width, so the whole input can be validated as words and names checked by their hash
+    static constexpr bool fixed_layout = ((Args::fixed_size > 0) && ...);
+    static constexpr int fixed_size = fixed_layout ? (0 + ... + Args::fixed_size) : -1;
+
     static datetime parse_datetime(const char *date) {
         datetime_struct pack{};
         const char *state = date;
         parse_impl(&state, pack);
-        return datetime{pack.day, pack.month, pack.year, pack.hour, pack.minute, pack.second, pack.microsecond};
+        return datetime{pack.day, pack.month, pack.year, pack.hour, pack.minute, pack.second, static_cast<int>(pack.microsecond)};
+    }
+
+    /**
+     * @brief Parses a length bounded, untrusted string, range checking every field.
+     *
+     * Fixed layouts of the expected length are validated a word at a time and converted without further checks.
+     * Anything else, including every failure, goes through the per field checks which report the exact position.
+     */
+    static datetime parse_datetime_safe(const char *date, int length, parse_result &result) {
+        datetime_struct pack = make_checked_pack();
+        if constexpr (fixed_layout) {
+            if (length == fixed_size && parse_fixed_layout(date, pack)) {
+                result = {};
+                return datetime{pack.day, pack.month, pack.year, pack.hour, pack.minute, pack.second, static_cast<int>(pack.microsecond)};
+            }
+            pack = make_checked_pack();
+        }
+        parse_cursor cursor = make_parse_cursor(date, length);
+        if ((Args::parse_checked(cursor, pack) && ...) && parse_checked_finish(cursor, pack)) {
+            result = {};
+            return datetime{pack.day, pack.month, pack.year, pack.hour, pack.minute, pack.second, static_cast<int>(pack.microsecond)};
+        }
+        result = cursor.result;
+        return DATETIME_INVALID;
     }
 
     static void put_datetime(datetime date, char *out) {
@@ -377,7 +910,62 @@ template <class... Args> struct perfect_parser {
         end_string(out_ptr);
     }
 
+    static datetime_string<max_size> to_string(datetime date) {
+        datetime_string<max_size> result;
+        datetime_struct pack;
+        date.to_pack(pack);
+        char *out_ptr = result.buffer;
+        put_impl(&out_ptr, pack);
+        end_string(out_ptr);
+        result.length = static_cast<int>(out_ptr - result.buffer);
+        return result;
+    }
+
   private:
+    static constexpr int layout_words = fixed_layout ? (fixed_size + 7) / 8 : 1;
+
+    struct layout_masks {
+        unsigned long long digits[layout_words]; // high bit set where a digit is expected
+        unsigned long long checked[layout_words]; // high bit set where the digit flag must match
+    };
+
+    static constexpr layout_masks make_layout_masks() {
+        layout_masks masks{};
+        const int sizes[] = {Args::fixed_size...};
+        const char layouts[] = {Args::layout...};
+        int offset = 0;
+        for (int field = 0; field < static_cast<int>(sizeof...(Args)); field++) {
+            for (int i = 0; i < sizes[field]; i++, offset++) {
+                const unsigned long long bit = 0x80ULL << (8 * (offset % 8));
+                if (layouts[field] == 'd')
+                    masks.digits[offset / 8] |= bit;
+                masks.checked[offset / 8] |= bit;
+            }
+        }
+        return masks;
+    }
+
+    static constexpr layout_masks masks = make_layout_masks();
+
+    static bool parse_fixed_layout(const char *date, datetime_struct &pack) {
+        constexpr int full_words = fixed_size / 8;
+        unsigned long long mismatch = 0;
+        for (int word = 0; word < full_words; word++)
+            mismatch |= (datetime_swar_digit_flags(datetime_swar_load(date + word * 8)) ^ masks.digits[word]) & masks.checked[word];
+        if constexpr (full_words < layout_words) {
+            // The last partial word is zero padded so nothing past the input is read
+            char tail[8] = {};
+            for (int i = 0; i < fixed_size - full_words * 8; i++) tail[i] = date[full_words * 8 + i];
+            mismatch |= (datetime_swar_digit_flags(datetime_swar_load(tail)) ^ masks.digits[full_words]) & masks.checked[full_words];
+        }
+        if (mismatch != 0)
+            return false;
+        const char *field = date;
+        bool names_valid = true;
+        ((names_valid &= Args::parse_fixed(field, pack), field += Args::fixed_size), ...);
+        return names_valid && datetime_pack_in_range(pack);
+    }
+
     static void parse_impl(const char **state, datetime_struct &pack) { ((void)Args{}.parse(state, pack), ...); }
     static void put_impl(char **out, datetime_struct &pack) { (Args{}.puts(out, pack), ...); }
 };
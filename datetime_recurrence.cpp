@@ -0,0 +1,524 @@
+#include "datetime_recurrence.h"
+#include "datetime_calendar.h"
+#include "datetime_parser.h"
+namespace gtr {
+
+constexpr unsigned int weekdays_monday_to_friday = 0x3E;
+constexpr long long microseconds_per_second = 1000000LL;
+
+// Lowest set bit at or above position, -1 if none
+static inline int next_bit(unsigned long long mask, int position) {
+    if (position > 63)
+        return -1;
+    mask = mask >> position << position;
+    return mask == 0 ? -1 : datetime_count_trailing_zeros(mask);
+}
+
+// Highest set bit at or below position, -1 if none
+static inline int prev_bit(unsigned long long mask, int position) {
+    if (position < 0)
+        return -1;
+    if (position < 63)
+        mask &= (2ULL << position) - 1;
+    return mask == 0 ? -1 : 63 - datetime_count_leading_zeros(mask);
+}
+
+// Days 1 - length falling on the weekdays of the mask, bit d for day d
+static inline unsigned long long weekday_days(unsigned int weekdays, int first_weekday, int length) {
+    // Rotate so bit k is the weekday of day k + 1, then repeat the week over the 35 bits of five weeks
+    const unsigned int rotated = ((weekdays >> first_weekday) | (weekdays << (7 - first_weekday))) & 0x7F;
+    unsigned long long days = 0;
+    for (int week = 0; week < 5; week++) days |= static_cast<unsigned long long>(rotated) << (7 * week + 1);
+    return days & ((2ULL << length) - 2);
+}
+
+unsigned long long recurrence::day_mask(int year, int month) const {
+    if ((months >> month & 1) == 0)
+        return 0;
+    const int length = calendar_month_length(year, month);
+    const unsigned long long all = (2ULL << length) - 2;
+    const int first_weekday = day_of_week_from_days(days_from_civil(year, month, 1));
+    unsigned long long of_month = static_cast<unsigned long long>(days) & all;
+    if (last_day)
+        of_month |= 1ULL << length;
+    if (last_weekdays != 0) {
+        const unsigned long long candidates = weekday_days(last_weekdays, first_weekday, length);
+        if (candidates != 0)
+            of_month |= 1ULL << (63 - datetime_count_leading_zeros(candidates));
+    }
+    const unsigned long long of_week = weekday_days(weekdays, first_weekday, length);
+    return days_restricted && weekdays_restricted ? of_month | of_week : of_month & of_week;
+}
+
+// The fields of a time in whole seconds
+struct recurrence_cursor {
+    int year, month, day, hour, minute, second;
+
+    inline void set(long long seconds) {
+        const long long days = seconds / 86400 - (seconds % 86400 < 0);
+        int second_of_day = static_cast<int>(seconds - days * 86400);
+        civil_from_days(static_cast<int>(days), year, month, day);
+        hour = second_of_day / 3600;
+        minute = second_of_day / 60 % 60;
+        second = second_of_day % 60;
+    }
+
+    inline datetime get() const {
+        return days_from_civil(year, month, day) * DATETIME_MICROSECONDS_PER_DAY +
+               (hour * 3600LL + minute * 60LL + second) * microseconds_per_second;
+    }
+};
+
+datetime recurrence::next_after(datetime time) const {
+    // The first whole second after time
+    const long long floor_seconds = time.data / microseconds_per_second - (time.data % microseconds_per_second < 0);
+    recurrence_cursor at;
+    at.set(floor_seconds + 1);
+    const int last_year = at.year + 400;
+    while (at.year <= last_year) {
+        const int month = next_bit(months, at.month);
+        if (month < 0) {
+            at = {at.year + 1, 1, 1, 0, 0, 0};
+            continue;
+        }
+        if (month != at.month)
+            at = {at.year, month, 1, 0, 0, 0};
+        const int day = next_bit(day_mask(at.year, at.month), at.day);
+        if (day < 0) {
+            at = at.month == 12 ? recurrence_cursor{at.year + 1, 1, 1, 0, 0, 0} : recurrence_cursor{at.year, at.month + 1, 1, 0, 0, 0};
+            continue;
+        }
+        if (day != at.day)
+            at = {at.year, at.month, day, 0, 0, 0};
+        const int hour = next_bit(hours, at.hour);
+        if (hour < 0) {
+            // Day 32 has no bit in any day mask, the next pass moves to the next month
+            at = {at.year, at.month, at.day + 1, 0, 0, 0};
+            continue;
+        }
+        if (hour != at.hour)
+            at = {at.year, at.month, at.day, hour, 0, 0};
+        const int minute = next_bit(minutes, at.minute);
+        if (minute < 0) {
+            at = {at.year, at.month, at.day, at.hour + 1, 0, 0};
+            continue;
+        }
+        if (minute != at.minute)
+            at = {at.year, at.month, at.day, at.hour, minute, 0};
+        const int second = next_bit(seconds, at.second);
+        if (second < 0) {
+            at = {at.year, at.month, at.day, at.hour, at.minute + 1, 0};
+            continue;
+        }
+        at.second = second;
+        return at.get();
+    }
+    return DATETIME_INVALID;
+}
+
+datetime recurrence::prev_before(datetime time) const {
+    // The last whole second before time
+    const long long before = time.data - 1;
+    recurrence_cursor at;
+    at.set(before / microseconds_per_second - (before % microseconds_per_second < 0));
+    const int first_year = at.year - 400;
+    while (at.year >= first_year) {
+        const int month = prev_bit(months, at.month);
+        if (month < 0) {
+            at = {at.year - 1, 12, 31, 23, 59, 59};
+            continue;
+        }
+        if (month != at.month)
+            at = {at.year, month, 31, 23, 59, 59};
+        const int day = prev_bit(day_mask(at.year, at.month), at.day);
+        if (day < 0) {
+            at = at.month == 1 ? recurrence_cursor{at.year - 1, 12, 31, 23, 59, 59} : recurrence_cursor{at.year, at.month - 1, 31, 23, 59, 59};
+            continue;
+        }
+        if (day != at.day)
+            at = {at.year, at.month, day, 23, 59, 59};
+        const int hour = prev_bit(hours, at.hour);
+        if (hour < 0) {
+            // Day 0 has no bit in any day mask, the next pass moves to the previous month
+            at = {at.year, at.month, at.day - 1, 23, 59, 59};
+            continue;
+        }
+        if (hour != at.hour)
+            at = {at.year, at.month, at.day, hour, 59, 59};
+        const int minute = prev_bit(minutes, at.minute);
+        if (minute < 0) {
+            at = {at.year, at.month, at.day, at.hour - 1, 59, 59};
+            continue;
+        }
+        if (minute != at.minute)
+            at = {at.year, at.month, at.day, at.hour, minute, 59};
+        const int second = prev_bit(seconds, at.second);
+        if (second < 0) {
+            at = {at.year, at.month, at.day, at.hour, at.minute - 1, 59};
+            continue;
+        }
+        at.second = second;
+        return at.get();
+    }
+    return DATETIME_INVALID;
+}
+
+bool recurrence::matches(datetime time) const {
+    if (time.data % microseconds_per_second != 0)
+        return false;
+    recurrence_cursor at;
+    at.set(time.data / microseconds_per_second);
+    return (seconds >> at.second & 1) && (minutes >> at.minute & 1) && (hours >> at.hour & 1) && (day_mask(at.year, at.month) >> at.day & 1);
+}
+
+long long recurrence::occurrences(datetime from, datetime to, datetime *out, long long capacity) const {
+    long long written = 0;
+    datetime at = matches(from) ? from : next_after(from);
+    while (written < capacity && at.data != DATETIME_INVALID && at.data < to.data) {
+        out[written++] = at;
+        at = next_after(at);
+    }
+    return written;
+}
+
+// Bits low - high every step
+static inline unsigned long long bit_range(int low, int high, int step) {
+    unsigned long long mask = 0;
+    for (int value = low; value <= high; value += step) mask |= 1ULL << value;
+    return mask;
+}
+
+static inline bool is_letter(char c) { return (c | 0x20) >= 'a' && (c | 0x20) <= 'z'; }
+
+static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static inline bool is_blank(char c) { return c == ' ' || c == '\t'; }
+
+enum class cron_names { none, months, weekdays };
+
+// A number or a three letter name
+static bool parse_cron_value(const char *&p, const char *end, cron_names names, int &value) {
+    if (p < end && is_digit(*p)) {
+        value = 0;
+        while (p < end && is_digit(*p)) {
+            value = value * 10 + (*p++ - '0');
+            if (value > 1000)
+                return false;
+        }
+        return true;
+    }
+    if (names == cron_names::none || end - p < 3 || !is_letter(p[0]) || !is_letter(p[1]) || !is_letter(p[2]) || (end - p > 3 && is_letter(p[3])))
+        return false;
+    value = names == cron_names::months ? datetime_month_from_name(p) : datetime_weekday_from_name(p);
+    if (value < (names == cron_names::months ? 1 : 0))
+        return false;
+    p += 3;
+    return true;
+}
+
+// One comma separated field, low - high the values accepted
+static bool parse_cron_field(const char *p, const char *end, int low, int high, cron_names names, unsigned long long &mask) {
+    mask = 0;
+    while (p < end) {
+        int first = low, last = high, step = 1;
+        if (*p == '*') {
+            p++;
+        } else {
+            if (!parse_cron_value(p, end, names, first))
+                return false;
+            last = first;
+            if (p < end && *p == '-') {
+                p++;
+                if (!parse_cron_value(p, end, names, last))
+                    return false;
+            } else if (p < end && *p == '/') {
+                // "a/n" runs from a to the end of the field
+                last = high;
+            }
+        }
+        if (p < end && *p == '/') {
+            p++;
+            if (!parse_cron_value(p, end, cron_names::none, step) || step == 0)
+                return false;
+        }
+        if (first < low || last > high || first > last)
+            return false;
+        mask |= bit_range(first, last, step);
+        if (p < end && *p != ',')
+            return false;
+        if (p < end)
+            p++;
+    }
+    return mask != 0;
+}
+
+static bool parse_cron_days(const char *p, const char *end, recurrence &out) {
+    out.days_restricted = !(*p == '*' || *p == '?');
+    if (end - p == 1 && *p == '?') {
+        out.days = bit_range(1, 31, 1);
+        return true;
+    }
+    // L and LW are elements of the list
+    unsigned long long mask = 0;
+    const char *element = p;
+    while (element < end) {
+        const char *next = element;
+        while (next < end && *next != ',') next++;
+        if (next - element == 1 && (*element | 0x20) == 'l') {
+            out.last_day = true;
+        } else if (next - element == 2 && (element[0] | 0x20) == 'l' && (element[1] | 0x20) == 'w') {
+            out.last_weekdays = weekdays_monday_to_friday;
+        } else {
+            unsigned long long values = 0;
+            if (!parse_cron_field(element, next, 1, 31, cron_names::none, values))
+                return false;
+            mask |= values;
+        }
+        element = next < end ? next + 1 : next;
+    }
+    out.days = static_cast<unsigned int>(mask);
+    return true;
+}
+
+static bool parse_cron_weekdays(const char *p, const char *end, recurrence &out) {
+    out.weekdays_restricted = !(*p == '*' || *p == '?');
+    unsigned long long mask = 0;
+    if (end - p == 1 && *p == '?')
+        mask = 0x7F;
+    else if (!parse_cron_field(p, end, 0, 7, cron_names::weekdays, mask))
+        return false;
+    // 7 is Sunday as well
+    out.weekdays = static_cast<unsigned int>((mask | mask >> 7) & 0x7F);
+    return true;
+}
+
+static bool cron_equals(const char *text, const char *name) {
+    for (; *name != '\0'; text++, name++)
+        if ((is_letter(*text) ? *text | 0x20 : *text) != *name)
+            return false;
+    return *text == '\0' || is_blank(*text);
+}
+
+bool parse_cron(const char *text, recurrence &out) {
+    while (is_blank(*text)) text++;
+    if (*text == '@') {
+        static const struct {
+            const char *name;
+            const char *expression;
+        } macros[] = {{"@yearly", "0 0 1 1 *"}, {"@annually", "0 0 1 1 *"}, {"@monthly", "0 0 1 * *"}, {"@weekly", "0 0 * * 0"},
+                      {"@daily", "0 0 * * *"},  {"@midnight", "0 0 * * *"}, {"@hourly", "0 * * * *"}};
+        for (const auto &macro : macros)
+            if (cron_equals(text, macro.name))
+                return parse_cron(macro.expression, out);
+        return false;
+    }
+
+    const char *begins[6], *ends[6];
+    int fields = 0;
+    while (*text != '\0') {
+        if (fields == 6)
+            return false;
+        begins[fields] = text;
+        while (*text != '\0' && !is_blank(*text)) text++;
+        ends[fields++] = text;
+        while (is_blank(*text)) text++;
+    }
+    if (fields != 5 && fields != 6)
+        return false;
+
+    recurrence parsed;
+    const int first = fields - 5;
+    unsigned long long mask = 0;
+    if (fields == 6) {
+        if (!parse_cron_field(begins[0], ends[0], 0, 59, cron_names::none, mask))
+            return false;
+        parsed.seconds = mask;
+    }
+    if (!parse_cron_field(begins[first], ends[first], 0, 59, cron_names::none, parsed.minutes))
+        return false;
+    if (!parse_cron_field(begins[first + 1], ends[first + 1], 0, 23, cron_names::none, mask))
+        return false;
+    parsed.hours = static_cast<unsigned int>(mask);
+    if (!parse_cron_days(begins[first + 2], ends[first + 2], parsed))
+        return false;
+    if (!parse_cron_field(begins[first + 3], ends[first + 3], 1, 12, cron_names::months, mask))
+        return false;
+    parsed.months = static_cast<unsigned int>(mask);
+    if (!parse_cron_weekdays(begins[first + 4], ends[first + 4], parsed))
+        return false;
+    out = parsed;
+    return true;
+}
+
+enum class rrule_frequency { none, secondly, minutely, hourly, daily, weekly, monthly, yearly };
+
+static bool rrule_key(const char *&p, const char *name) {
+    const char *q = p;
+    while (*name != '\0')
+        if ((*q++ & ~0x20) != *name++)
+            return false;
+    if (*q != '=')
+        return false;
+    p = q + 1;
+    return true;
+}
+
+// A comma separated list of integers low - high, or -1 which sets minus_one
+static bool rrule_numbers(const char *&p, int low, int high, unsigned long long &mask, bool &minus_one) {
+    mask = 0;
+    for (;;) {
+        const bool negative = *p == '-';
+        if (negative || *p == '+')
+            p++;
+        int value = 0;
+        if (!parse_cron_value(p, p + 4, cron_names::none, value))
+            return false;
+        if (negative) {
+            if (value != 1)
+                return false;
+            minus_one = true;
+        } else {
+            if (value < low || value > high)
+                return false;
+            mask |= 1ULL << value;
+        }
+        if (*p != ',')
+            return true;
+        p++;
+    }
+}
+
+static bool rrule_weekdays(const char *&p, unsigned int &mask) {
+    static const char names[] = "SUMOTUWETHFRSA";
+    mask = 0;
+    for (;;) {
+        if (is_digit(*p) || *p == '-' || *p == '+')
+            return false; // ordinals such as 1MO or -1FR
+        int day = 0;
+        while (day < 7 && !((p[0] & ~0x20) == names[2 * day] && (p[1] & ~0x20) == names[2 * day + 1])) day++;
+        if (day == 7)
+            return false;
+        mask |= 1U << day;
+        p += 2;
+        if (*p != ',')
+            return true;
+        p++;
+    }
+}
+
+bool parse_rrule(const char *text, recurrence &out, datetime start) {
+    const char *p = text;
+    if ((p[0] & ~0x20) == 'R' && (p[1] & ~0x20) == 'R' && (p[2] & ~0x20) == 'U' && (p[3] & ~0x20) == 'L' && (p[4] & ~0x20) == 'E' && p[5] == ':')
+        p += 6;
+
+    rrule_frequency frequency = rrule_frequency::none;
+    int interval = 1, set_position = 0;
+    unsigned long long by_month = 0, by_month_day = 0, by_hour = 0, by_minute = 0, by_second = 0;
+    unsigned int by_day = 0;
+    bool last_month_day = false, minus_one = false;
+    while (*p != '\0') {
+        if (rrule_key(p, "FREQ")) {
+            static const char *const names[] = {"SECONDLY", "MINUTELY", "HOURLY", "DAILY", "WEEKLY", "MONTHLY", "YEARLY"};
+            int found = -1;
+            for (int i = 0; i < 7 && found < 0; i++) {
+                const char *q = p;
+                const char *name = names[i];
+                while (*name != '\0' && (*q & ~0x20) == *name) q++, name++;
+                if (*name == '\0' && (*q == ';' || *q == '\0')) {
+                    found = i;
+                    p = q;
+                }
+            }
+            if (found < 0)
+                return false;
+            frequency = static_cast<rrule_frequency>(found + 1);
+        } else if (rrule_key(p, "INTERVAL")) {
+            if (!parse_cron_value(p, p + 4, cron_names::none, interval) || interval == 0)
+                return false;
+        } else if (rrule_key(p, "BYMONTH")) {
+            if (!rrule_numbers(p, 1, 12, by_month, minus_one) || minus_one)
+                return false;
+        } else if (rrule_key(p, "BYMONTHDAY")) {
+            if (!rrule_numbers(p, 1, 31, by_month_day, last_month_day))
+                return false;
+        } else if (rrule_key(p, "BYDAY")) {
+            if (!rrule_weekdays(p, by_day))
+                return false;
+        } else if (rrule_key(p, "BYHOUR")) {
+            if (!rrule_numbers(p, 0, 23, by_hour, minus_one) || minus_one)
+                return false;
+        } else if (rrule_key(p, "BYMINUTE")) {
+            if (!rrule_numbers(p, 0, 59, by_minute, minus_one) || minus_one)
+                return false;
+        } else if (rrule_key(p, "BYSECOND")) {
+            if (!rrule_numbers(p, 0, 59, by_second, minus_one) || minus_one)
+                return false;
+        } else if (rrule_key(p, "BYSETPOS")) {
+            if (p[0] != '-' || p[1] != '1')
+                return false;
+            set_position = -1;
+            p += 2;
+        } else if (rrule_key(p, "WKST")) {
+            while (is_letter(*p)) p++;
+        } else {
+            return false;
+        }
+        if (*p == ';')
+            p++;
+        else if (*p != '\0')
+            return false;
+    }
+    if (frequency == rrule_frequency::none)
+        return false;
+
+    recurrence_cursor anchor;
+    anchor.set(start.data / microseconds_per_second - (start.data % microseconds_per_second < 0));
+    const int anchor_weekday = day_of_week_from_days(days_from_civil(anchor.year, anchor.month, anchor.day));
+
+    // INTERVAL is a step of the field the frequency counts, it must divide the period of that field
+    const int period = frequency == rrule_frequency::secondly || frequency == rrule_frequency::minutely ? 60 : frequency == rrule_frequency::hourly ? 24 : 1;
+    if (period % interval != 0)
+        return false;
+
+    recurrence parsed;
+    const auto every = [](int anchor_value, int high, int step) { return bit_range(anchor_value % step, high, step); };
+    parsed.seconds = by_second != 0                             ? by_second
+                     : frequency == rrule_frequency::secondly ? every(anchor.second, 59, interval)
+                                                              : 1ULL << anchor.second;
+    parsed.minutes = by_minute != 0                              ? by_minute
+                     : frequency == rrule_frequency::minutely  ? every(anchor.minute, 59, interval)
+                     : frequency == rrule_frequency::secondly ? bit_range(0, 59, 1)
+                                                               : 1ULL << anchor.minute;
+    parsed.hours = static_cast<unsigned int>(by_hour != 0                                ? by_hour
+                                             : frequency == rrule_frequency::hourly     ? every(anchor.hour, 23, interval)
+                                             : frequency <= rrule_frequency::minutely   ? bit_range(0, 23, 1)
+                                                                                         : 1ULL << anchor.hour);
+    parsed.months = static_cast<unsigned int>(by_month != 0 ? by_month
+                                              : frequency == rrule_frequency::yearly && by_month_day == 0 && !last_month_day && by_day == 0
+                                                  ? 1ULL << anchor.month
+                                                  : bit_range(1, 12, 1));
+
+    const bool month_days = by_month_day != 0 || last_month_day;
+    if (set_position == -1) {
+        // The last day of the month on one of the BYDAY weekdays
+        if (by_day == 0 || month_days || frequency != rrule_frequency::monthly)
+            return false;
+        parsed.last_weekdays = by_day;
+        parsed.weekdays = 0x7F;
+    } else {
+        // Unlike cron both day rules must match, the restricted flags stay false
+        parsed.days = month_days ? static_cast<unsigned int>(by_month_day) : static_cast<unsigned int>(bit_range(1, 31, 1));
+        parsed.last_day = last_month_day;
+        parsed.weekdays = by_day != 0 ? by_day : 0x7F;
+        if (!month_days && by_day == 0) {
+            // The day the frequency leaves free comes from the start
+            if (frequency == rrule_frequency::weekly)
+                parsed.weekdays = 1U << anchor_weekday;
+            else if (frequency >= rrule_frequency::monthly)
+                parsed.days = 1U << anchor.day;
+        }
+    }
+    out = parsed;
+    return true;
+}
+} // namespace gtr
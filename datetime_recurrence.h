@@ -0,0 +1,80 @@
+#ifndef DATETIME_RECURRENCE_H
+#define DATETIME_RECURRENCE_H
+#include "datetime.h"
+
+// Recurring schedules parsed from cron expressions or a subset of RFC 5545 RRULEs and compiled into one bitset
+// per field. The next and previous occurrences are found by scanning the bitsets, a field at a time, so a search
+// jumps over whole months and years instead of stepping minute by minute. Times are UTC, occurrences whole seconds.
+namespace gtr {
+
+/**
+ * A compiled recurrence: a time occurs when its second, minute, hour, month and day all match.
+ *
+ * The day matches when both the day of the month and the weekday match, except as in cron when both fields are
+ * restricted (neither starts with '*'), then either may match.
+ */
+struct recurrence {
+    unsigned long long seconds{1};  /**< Bits 0 - 59. */
+    unsigned long long minutes{0};  /**< Bits 0 - 59. */
+    unsigned int hours{0};          /**< Bits 0 - 23. */
+    unsigned int days{0};           /**< Bits 1 - 31, the days of the month. */
+    unsigned int months{0};         /**< Bits 1 - 12. */
+    unsigned int weekdays{0};       /**< Bits 0 - 6, 0 = Sunday. */
+    bool last_day{false};           /**< Also the last day of the month (cron L, RRULE BYMONTHDAY=-1). */
+    unsigned int last_weekdays{0};  /**< Also the last day of the month on one of these weekdays (cron LW: Monday - Friday). */
+    bool days_restricted{false};    /**< The cron day of the month field did not start with '*' or '?'. */
+    bool weekdays_restricted{false}; /**< The cron weekday field did not start with '*' or '?'. */
+
+    /**
+     * @brief Returns the first occurrence after time, DATETIME_INVALID if none in the next 400 years.
+     */
+    datetime next_after(datetime time) const;
+
+    /**
+     * @brief Returns the last occurrence before time, DATETIME_INVALID if none in the previous 400 years.
+     */
+    datetime prev_before(datetime time) const;
+
+    /**
+     * @brief Returns true if time is an occurrence.
+     */
+    bool matches(datetime time) const;
+
+    /**
+     * @brief Writes the occurrences in [from, to).
+     *
+     * from is included when it is an occurrence, so to get the rest continue from the last one written plus one
+     * microsecond, not from the last one itself.
+     * @return The number written, at most capacity.
+     */
+    long long occurrences(datetime from, datetime to, datetime *out, long long capacity) const;
+
+    /**
+     * @brief The bits of the days of the month matching in a month, bit d for day d.
+     */
+    unsigned long long day_mask(int year, int month) const;
+};
+
+/**
+ * @brief Compiles a cron expression.
+ *
+ * Five fields "minute hour day month weekday", or six with seconds first. Fields accept '*', values, ranges
+ * "a-b", steps "a-b/n" (or '*' followed by "/n") and lists "a,b". Months and weekdays also accept names (JAN, MON),
+ * weekday 7 is Sunday. The day accepts '?', 'L' for the last day and 'LW' for the last weekday of the month.
+ * Also accepts @yearly, @annually, @monthly, @weekly, @daily, @midnight and @hourly.
+ * @return False if the expression is malformed, out is then unchanged.
+ */
+bool parse_cron(const char *text, recurrence &out);
+
+/**
+ * @brief Compiles an RFC 5545 RRULE, with or without the "RRULE:" prefix.
+ *
+ * Supports FREQ, INTERVAL where it divides the period above (e.g. FREQ=MINUTELY;INTERVAL=15), BYMONTH, BYMONTHDAY
+ * (1 - 31 and -1), BYDAY without ordinals, BYSETPOS=-1 with BYDAY for the last such day of the month, BYHOUR,
+ * BYMINUTE and BYSECOND. The fields the rule leaves free are taken from start, like DTSTART.
+ * COUNT and UNTIL are not part of the recurrence, bound the occurrences by time instead.
+ * @return False if the rule is malformed or uses an unsupported part, out is then unchanged.
+ */
+bool parse_rrule(const char *text, recurrence &out, datetime start = datetime());
+} // namespace gtr
+#endif
@@ -0,0 +1,322 @@
+// Rewrites a timestamp column of delimited text from one format to another.
+//
+//   ./datetime_reformat --from <format|iso> --to <format|iso> [--column <n>] [--delimiter <c>] [--shift-minutes <n>]
+//                       [--header] [--threads <n>] [file...]
+//
+// Reads the files in order, or stdin, and writes to stdout. Columns count from 1, a field that does not parse is left
+// as it is and counted on stderr. With --header the first line of each file is copied as it is. Quoted fields are
+// parsed without their quotes and written back quoted.
+//
+// The work is a pipeline: a reader cuts the input into blocks of whole lines, workers reformat blocks in parallel and
+// a writer puts them back in order. Blocks come from a fixed pool and are reused, every queue is bounded, so memory
+// stays flat whatever the input size.
+#include "datetime.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace gtr;
+
+namespace {
+
+constexpr size_t block_size = 1 << 20;
+
+struct options {
+    const char *from = DATETIME_DEFAULT_FORMAT;
+    const char *to = DATETIME_DEFAULT_FORMAT;
+    date_format from_group = date_format::text_date;
+    date_format to_group = date_format::text_date;
+    int column = 1;
+    char delimiter = ',';
+    long long shift = 0; // microseconds
+    bool header = false;
+    int threads = 0;
+    std::vector<const char *> files;
+};
+
+struct block {
+    std::vector<char> input;
+    size_t input_size = 0;
+    std::vector<char> output;
+    size_t output_size = 0;
+    long long sequence = 0;
+    bool header = false; // the first line is the header, copied as it is
+    long long failed = 0;
+};
+
+// A queue that blocks producers when full and consumers when empty, until closed
+template <class T> class bounded_queue {
+  public:
+    explicit bounded_queue(size_t capacity) : capacity_(capacity) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return items_.size() < capacity_; });
+        items_.push_back(item);
+        not_empty_.notify_one();
+    }
+
+    // False once the queue is closed and drained
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return !items_.empty() || closed_; });
+        if (items_.empty())
+            return false;
+        item = items_.front();
+        items_.erase(items_.begin());
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+    }
+
+  private:
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    std::vector<T> items_;
+    size_t capacity_;
+    bool closed_ = false;
+};
+
+bool parse_format(const char *text, const char *&format, date_format &group) {
+    if (std::strcmp(text, "iso") == 0) {
+        format = "";
+        group = date_format::iso_date;
+    } else {
+        format = text;
+        group = date_format::text_date;
+    }
+    return *text != '\0';
+}
+
+bool parse_options(int argc, char **argv, options &opts) {
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        const bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--from") == 0 && has_value) {
+            valid = parse_format(argv[++i], opts.from, opts.from_group);
+        } else if (std::strcmp(argv[i], "--to") == 0 && has_value) {
+            valid = parse_format(argv[++i], opts.to, opts.to_group);
+        } else if (std::strcmp(argv[i], "--column") == 0 && has_value) {
+            opts.column = std::atoi(argv[++i]);
+            valid = opts.column >= 1;
+        } else if (std::strcmp(argv[i], "--delimiter") == 0 && has_value) {
+            const char *delimiter = argv[++i];
+            opts.delimiter = std::strcmp(delimiter, "\\t") == 0 || std::strcmp(delimiter, "tab") == 0 ? '\t' : delimiter[0];
+            valid = opts.delimiter != '\0' && opts.delimiter != '\n';
+        } else if (std::strcmp(argv[i], "--shift-minutes") == 0 && has_value) {
+            opts.shift = std::atoll(argv[++i]) * 60000000LL;
+        } else if (std::strcmp(argv[i], "--header") == 0) {
+            opts.header = true;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && has_value) {
+            opts.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (argv[i][0] != '-' || std::strcmp(argv[i], "-") == 0) {
+            opts.files.push_back(argv[i]);
+        } else {
+            valid = false;
+        }
+    }
+    if (valid && opts.to_group == date_format::text_date && datetime_format_capacity(opts.to) > 256)
+        valid = false;
+    if (!valid)
+        std::fprintf(stderr,
+                     "usage: %s --from <format|iso> --to <format|iso> [--column <n>] [--delimiter <c>] [--shift-minutes <n>] [--header] "
+                     "[--threads <n>] [file...]\n",
+                     argv[0]);
+    return valid;
+}
+
+// Reformats the field of one line, or copies the line when the field is missing or does not parse
+char *reformat_line(const options &opts, const char *line, const char *end, char *out, long long &failed) {
+    const char *field = line;
+    for (int c = 1; c < opts.column && field != nullptr; c++) {
+        field = static_cast<const char *>(std::memchr(field, opts.delimiter, static_cast<size_t>(end - field)));
+        field = field != nullptr ? field + 1 : nullptr;
+    }
+    datetime date;
+    if (field != nullptr) {
+        const char *field_end = static_cast<const char *>(std::memchr(field, opts.delimiter, static_cast<size_t>(end - field)));
+        field_end = field_end != nullptr ? field_end : end;
+        if (field_end == end && field_end > field && field_end[-1] == '\r')
+            field_end--;
+        const bool quoted = field_end - field >= 2 && *field == '"' && field_end[-1] == '"';
+        const char *text = field + quoted;
+        const int length = static_cast<int>(field_end - field) - 2 * quoted;
+        if (date.from_string_safe(text, length, opts.from, opts.from_group)) {
+            date.data += opts.shift;
+            std::memcpy(out, line, static_cast<size_t>(field - line));
+            out += field - line;
+            *out = '"';
+            out += quoted;
+            out += date.format_to(out, opts.to, opts.to_group);
+            *out = '"';
+            out += quoted;
+            std::memcpy(out, field_end, static_cast<size_t>(end - field_end));
+            return out + (end - field_end);
+        }
+    }
+    failed += end != line;
+    std::memcpy(out, line, static_cast<size_t>(end - line));
+    return out + (end - line);
+}
+
+void reformat_block(const options &opts, block &work) {
+    const char *p = work.input.data();
+    const char *input_end = p + work.input_size;
+    // Each line grows by at most the formatted field and two quotes
+    const size_t growth = static_cast<size_t>(opts.to_group == date_format::iso_date ? datetime_format_capacity("", date_format::iso_date)
+                                                                                      : datetime_format_capacity(opts.to)) + 2;
+    work.output_size = 0;
+    work.failed = 0;
+    while (p < input_end) {
+        const char *newline = static_cast<const char *>(std::memchr(p, '\n', static_cast<size_t>(input_end - p)));
+        const char *end = newline != nullptr ? newline : input_end;
+        const size_t needed = work.output_size + static_cast<size_t>(end - p) + growth + 1;
+        if (work.output.size() < needed)
+            work.output.resize(std::max(needed, work.output.size() * 2));
+        char *out = work.output.data() + work.output_size;
+        if (work.header && p == work.input.data()) {
+            std::memcpy(out, p, static_cast<size_t>(end - p));
+            out += end - p;
+        } else {
+            out = reformat_line(opts, p, end, out, work.failed);
+        }
+        if (newline != nullptr)
+            *out++ = '\n';
+        work.output_size = static_cast<size_t>(out - work.output.data());
+        p = newline != nullptr ? newline + 1 : input_end;
+    }
+}
+
+// Cuts each file into blocks ending at a line end, the partial line at the end of a block starts the next one
+bool read_blocks(const options &opts, bounded_queue<block *> &free_blocks, bounded_queue<block *> &work) {
+    std::vector<const char *> files = opts.files;
+    if (files.empty())
+        files.push_back("-");
+    long long sequence = 0;
+    std::vector<char> carry;
+    bool ok = true;
+    for (const char *path : files) {
+        const bool standard = std::strcmp(path, "-") == 0;
+        std::FILE *in = standard ? stdin : std::fopen(path, "rb");
+        if (in == nullptr) {
+            std::fprintf(stderr, "cannot open %s\n", path);
+            ok = false;
+            continue;
+        }
+        bool end_of_file = false;
+        bool first_block = true;
+        while (!end_of_file) {
+            block *next = nullptr;
+            free_blocks.pop(next);
+            if (next->input.size() < block_size)
+                next->input.resize(block_size);
+            std::memcpy(next->input.data(), carry.data(), carry.size());
+            size_t size = carry.size();
+            carry.clear();
+            const char *cut = nullptr;
+            while (cut == nullptr && !end_of_file) {
+                if (size == next->input.size())
+                    next->input.resize(next->input.size() * 2); // a line longer than a block
+                const size_t read = std::fread(next->input.data() + size, 1, next->input.size() - size, in);
+                end_of_file = read < next->input.size() - size;
+                const char *start = next->input.data() + size;
+                size += read;
+                // The last line end of the block, only the bytes just read can hold a new one
+                for (const char *p = next->input.data() + size; p > start && cut == nullptr; p--)
+                    if (p[-1] == '\n')
+                        cut = p;
+            }
+            if (!end_of_file) {
+                const size_t kept = static_cast<size_t>(cut - next->input.data());
+                carry.assign(next->input.data() + kept, next->input.data() + size);
+                size = kept;
+            }
+            next->input_size = size;
+            next->sequence = sequence;
+            // Every file starts with its own header
+            next->header = opts.header && first_block;
+            first_block = false;
+            sequence++;
+            work.push(next);
+        }
+        if (std::ferror(in)) {
+            std::fprintf(stderr, "cannot read %s\n", path);
+            ok = false;
+        }
+        if (!standard)
+            std::fclose(in);
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    options opts;
+    if (!parse_options(argc, argv, opts))
+        return 2;
+    int threads = opts.threads;
+    if (threads <= 0)
+        threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 2);
+
+    // Enough blocks for every worker, one being read and a few waiting to be written in order
+    const size_t pool_size = static_cast<size_t>(threads) * 2 + 2;
+    std::vector<block> pool(pool_size);
+    bounded_queue<block *> free_blocks(pool_size), work(pool_size), done(pool_size);
+    for (block &b : pool) free_blocks.push(&b);
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&] {
+            block *next = nullptr;
+            while (work.pop(next)) {
+                reformat_block(opts, *next);
+                done.push(next);
+            }
+        });
+    }
+
+    long long failed = 0;
+    bool written = true;
+    std::thread writer([&] {
+        std::map<long long, block *> pending;
+        long long expected = 0;
+        block *next = nullptr;
+        while (done.pop(next)) {
+            pending.emplace(next->sequence, next);
+            for (auto first = pending.begin(); first != pending.end() && first->first == expected; first = pending.begin()) {
+                block *ready = first->second;
+                written &= std::fwrite(ready->output.data(), 1, ready->output_size, stdout) == ready->output_size;
+                failed += ready->failed;
+                pending.erase(first);
+                expected++;
+                free_blocks.push(ready);
+            }
+        }
+    });
+
+    const bool read = read_blocks(opts, free_blocks, work);
+    work.close();
+    for (std::thread &worker : workers) worker.join();
+    done.close();
+    writer.join();
+    written &= std::fflush(stdout) == 0;
+
+    if (failed > 0)
+        std::fprintf(stderr, "%lld fields could not be parsed and were left as they were\n", failed);
+    if (!written)
+        std::fprintf(stderr, "cannot write the output\n");
+    return read && written ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+#ifndef DATETIME_SERIAL_H
+#define DATETIME_SERIAL_H
+#include "datetime_calendar.h"
+
+// Numeric time representations of other systems: Excel serial dates, Julian and Modified Julian Days, NTP timestamps,
+// Windows FILETIME and GPS week and time of week. Fractional days are split into whole days and an exact fraction
+// before scaling, so a double converts to the microsecond nearest its value instead of the product's rounding error.
+// The bulk versions are branch-free loops the compiler vectorizes.
+namespace gtr {
+
+/**
+ * @brief The day zero of an Excel workbook.
+ */
+enum class excel_epoch {
+    e1900, /**< Windows, serial 1 is 1900-01-01 and serial 60 the 1900-02-29 Lotus 1-2-3 believed in. */
+    e1904, /**< Older Mac workbooks, serial 0 is 1904-01-01. */
+};
+
+constexpr long long DATETIME_EXCEL_1900_DAYS = -25569;             // 1899-12-30, the day zero of serials from 61 on
+constexpr long long DATETIME_EXCEL_1904_DAYS = -24107;             // 1904-01-01
+constexpr long long DATETIME_JULIAN_DAY_EPOCH = 2440588;           // the Julian Day starting at noon on 1970-01-01
+constexpr long long DATETIME_MJD_EPOCH = 40587;                    // the Modified Julian Day of 1970-01-01
+constexpr long long DATETIME_NTP_EPOCH = 2208988800LL;             // seconds from 1900-01-01 to 1970-01-01
+constexpr long long DATETIME_FILETIME_EPOCH = 11644473600000000LL; // microseconds from 1601-01-01 to 1970-01-01
+constexpr long long DATETIME_GPS_EPOCH = 315964800LL;              // 1980-01-06 in Unix seconds
+constexpr long long DATETIME_GPS_WEEK = 604800000000LL;            // microseconds in a week
+
+// Fractional day counts are taken within this many days of their epoch, beyond that a double has no microseconds left
+constexpr double DATETIME_SERIAL_MAX_DAYS = 100000000.0;
+
+// The whole days and the exact fraction of days, rounded to the nearest microsecond
+constexpr inline long long serial_days_to_microseconds(double days, long long epoch_days) {
+    if (!(days > -DATETIME_SERIAL_MAX_DAYS && days < DATETIME_SERIAL_MAX_DAYS))
+        return DATETIME_INVALID;
+    long long whole = static_cast<long long>(days);
+    whole -= static_cast<double>(whole) > days;
+    const double fraction = days - static_cast<double>(whole);
+    return (whole + epoch_days) * DATETIME_MICROSECONDS_PER_DAY + static_cast<long long>(fraction * 86400000000.0 + 0.5);
+}
+
+constexpr inline double microseconds_to_serial_days(long long data, long long epoch_days) {
+    const long long days = datetime_day_number(data);
+    const long long rest = data - days * DATETIME_MICROSECONDS_PER_DAY;
+    return static_cast<double>(days - epoch_days) + static_cast<double>(rest) / 86400000000.0;
+}
+
+/**
+ * @brief Converts an Excel serial date, days and fraction of a day, to the nearest microsecond.
+ *
+ * In the 1900 system serials below 61 count from 1899-12-31, serial 60 reads as 1900-03-01.
+ * @return DATETIME_INVALID if the serial is not finite or more than 100 million days away.
+ */
+constexpr inline datetime datetime_from_excel(double serial, excel_epoch epoch = excel_epoch::e1900) {
+    if (epoch == excel_epoch::e1904)
+        return serial_days_to_microseconds(serial, DATETIME_EXCEL_1904_DAYS);
+    return serial_days_to_microseconds(serial, DATETIME_EXCEL_1900_DAYS + (serial < 61.0));
+}
+
+/**
+ * @brief Converts to an Excel serial date. The value round trips exactly up to serial 65535 (2079).
+ */
+constexpr inline double datetime_to_excel(datetime date, excel_epoch epoch = excel_epoch::e1900) {
+    if (epoch == excel_epoch::e1904)
+        return microseconds_to_serial_days(date.data, DATETIME_EXCEL_1904_DAYS);
+    // Before 1900-03-01, serial 61, the serials skip the missing leap day
+    return microseconds_to_serial_days(date.data, DATETIME_EXCEL_1900_DAYS) - (date.data < (DATETIME_EXCEL_1900_DAYS + 61) * DATETIME_MICROSECONDS_PER_DAY);
+}
+
+/**
+ * @brief Converts a Julian Day, counted from noon, to the nearest microsecond.
+ *
+ * A double holds Julian Days of our era to about 20µs, use the Modified Julian Day where precision matters.
+ */
+constexpr inline datetime datetime_from_julian_day(double julian_day) {
+    const long long data = serial_days_to_microseconds(julian_day, -DATETIME_JULIAN_DAY_EPOCH);
+    return data == DATETIME_INVALID ? data : data + DATETIME_MICROSECONDS_PER_DAY / 2;
+}
+
+constexpr inline double datetime_to_julian_day(datetime date) {
+    return microseconds_to_serial_days(date.data - DATETIME_MICROSECONDS_PER_DAY / 2, -DATETIME_JULIAN_DAY_EPOCH);
+}
+
+/**
+ * @brief Converts a Modified Julian Day to the nearest microsecond, it round trips exactly up to MJD 65535 (2038).
+ */
+constexpr inline datetime datetime_from_mjd(double mjd) { return serial_days_to_microseconds(mjd, -DATETIME_MJD_EPOCH); }
+
+constexpr inline double datetime_to_mjd(datetime date) { return microseconds_to_serial_days(date.data, -DATETIME_MJD_EPOCH); }
+
+/**
+ * @brief Converts a 64 bit NTP timestamp, 32 bits of seconds and 32 of fraction, to the nearest microsecond.
+ * @param era The NTP era, 0 from 1900 to 2036-02-07, 1 after.
+ */
+constexpr inline datetime datetime_from_ntp(unsigned long long timestamp, int era = 0) {
+    const long long seconds = static_cast<long long>(timestamp >> 32) + (static_cast<long long>(era) << 32) - DATETIME_NTP_EPOCH;
+    return seconds * 1000000LL + static_cast<long long>(((timestamp & 0xFFFFFFFFULL) * 1000000ULL + 0x80000000ULL) >> 32);
+}
+
+/**
+ * @brief The NTP era of a datetime, the era its timestamp is relative to.
+ */
+constexpr inline int datetime_ntp_era(datetime date) {
+    const long long seconds = date.data / 1000000LL - (date.data % 1000000LL < 0) + DATETIME_NTP_EPOCH;
+    return static_cast<int>(seconds >> 32);
+}
+
+/**
+ * @brief Converts to a 64 bit NTP timestamp within its era, the fraction rounded to the nearest 2^-32 second.
+ */
+constexpr inline unsigned long long datetime_to_ntp(datetime date) {
+    const long long seconds = date.data / 1000000LL - (date.data % 1000000LL < 0);
+    const unsigned long long rest = static_cast<unsigned long long>(date.data - seconds * 1000000LL);
+    return (static_cast<unsigned long long>(seconds + DATETIME_NTP_EPOCH) << 32) + (((rest << 32) + 500000ULL) / 1000000ULL);
+}
+
+/**
+ * @brief Converts a Windows FILETIME, 100ns units since 1601-01-01, truncated to the microsecond.
+ */
+constexpr inline datetime datetime_from_filetime(unsigned long long filetime) {
+    return static_cast<long long>(filetime / 10) - DATETIME_FILETIME_EPOCH;
+}
+
+/**
+ * @brief Converts to a Windows FILETIME, 0 before 1601.
+ */
+constexpr inline unsigned long long datetime_to_filetime(datetime date) {
+    return date.data < -DATETIME_FILETIME_EPOCH ? 0ULL : static_cast<unsigned long long>(date.data + DATETIME_FILETIME_EPOCH) * 10ULL;
+}
+
+// The UTC times, in Unix seconds, from which GPS time is one more second ahead of UTC
+constexpr long long gps_leap_seconds[] = {
+    362793600LL,  394329600LL,  425865600LL,  489024000LL,  567993600LL,  631152000LL,  662688000LL,  709948800LL,  741484800LL,
+    773020800LL,  820454400LL,  867715200LL,  915148800LL,  1136073600LL, 1230768000LL, 1341100800LL, 1435708800LL, 1483228800LL,
+};
+constexpr int DATETIME_GPS_LEAP_SECOND_COUNT = sizeof(gps_leap_seconds) / sizeof(gps_leap_seconds[0]);
+
+/**
+ * @brief The seconds GPS time is ahead of UTC at a UTC time, from the leap seconds up to 2017.
+ */
+constexpr inline int gps_utc_offset(datetime date) {
+    const long long seconds = date.data / 1000000LL - (date.data % 1000000LL < 0);
+    int offset = 0;
+    for (int i = 0; i < DATETIME_GPS_LEAP_SECOND_COUNT; i++) offset += seconds >= gps_leap_seconds[i];
+    return offset;
+}
+
+/**
+ * @brief Converts GPS week and microseconds of the week to UTC.
+ *
+ * The week is the full week number, add 1024 per rollover to the 10 bit week of the GPS message.
+ * A leap second itself reads as the midnight after it.
+ */
+constexpr inline datetime datetime_from_gps(int week, long long microseconds) {
+    const long long gps = DATETIME_GPS_EPOCH * 1000000LL + week * DATETIME_GPS_WEEK + microseconds;
+    const long long seconds = gps / 1000000LL - (gps % 1000000LL < 0);
+    // The leap second table in GPS seconds: each entry moved by the seconds ahead after it
+    int offset = 0;
+    for (int i = 0; i < DATETIME_GPS_LEAP_SECOND_COUNT; i++) offset += seconds >= gps_leap_seconds[i] + i + 1;
+    return gps - offset * 1000000LL;
+}
+
+/**
+ * @brief Converts GPS week and seconds of the week to UTC, to the nearest microsecond.
+ */
+constexpr inline datetime datetime_from_gps_seconds(int week, double seconds) {
+    long long whole = static_cast<long long>(seconds);
+    whole -= static_cast<double>(whole) > seconds;
+    return datetime_from_gps(week, whole * 1000000LL + static_cast<long long>((seconds - static_cast<double>(whole)) * 1000000.0 + 0.5));
+}
+
+/**
+ * @brief Converts UTC to GPS week and microseconds of the week.
+ */
+constexpr inline void datetime_to_gps(datetime date, int &week, long long &microseconds) {
+    const long long gps = date.data + gps_utc_offset(date) * 1000000LL - DATETIME_GPS_EPOCH * 1000000LL;
+    const long long weeks = gps / DATETIME_GPS_WEEK - (gps % DATETIME_GPS_WEEK < 0);
+    week = static_cast<int>(weeks);
+    microseconds = gps - weeks * DATETIME_GPS_WEEK;
+}
+
+inline void from_excel_bulk(const double *serials, datetime *out, long long count, excel_epoch epoch = excel_epoch::e1900) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_from_excel(serials[i], epoch);
+}
+
+inline void to_excel_bulk(const datetime *dates, double *out, long long count, excel_epoch epoch = excel_epoch::e1900) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_to_excel(dates[i], epoch);
+}
+
+inline void from_julian_day_bulk(const double *julian_days, datetime *out, long long count) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_from_julian_day(julian_days[i]);
+}
+
+inline void to_julian_day_bulk(const datetime *dates, double *out, long long count) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_to_julian_day(dates[i]);
+}
+
+inline void from_mjd_bulk(const double *mjds, datetime *out, long long count) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_from_mjd(mjds[i]);
+}
+
+inline void to_mjd_bulk(const datetime *dates, double *out, long long count) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_to_mjd(dates[i]);
+}
+
+inline void from_ntp_bulk(const unsigned long long *timestamps, datetime *out, long long count, int era = 0) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_from_ntp(timestamps[i], era);
+}
+
+inline void to_ntp_bulk(const datetime *dates, unsigned long long *out, long long count) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_to_ntp(dates[i]);
+}
+
+inline void from_filetime_bulk(const unsigned long long *filetimes, datetime *out, long long count) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_from_filetime(filetimes[i]);
+}
+
+inline void to_filetime_bulk(const datetime *dates, unsigned long long *out, long long count) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_to_filetime(dates[i]);
+}
+
+inline void from_gps_bulk(const int *weeks, const long long *microseconds, datetime *out, long long count) {
+    for (long long i = 0; i < count; i++) out[i] = datetime_from_gps(weeks[i], microseconds[i]);
+}
+
+inline void to_gps_bulk(const datetime *dates, int *weeks, long long *microseconds, long long count) {
+    for (long long i = 0; i < count; i++) datetime_to_gps(dates[i], weeks[i], microseconds[i]);
+}
+} // namespace gtr
+#endif
@@ -0,0 +1,377 @@
+#include "datetime_series.h"
+#include "datetime_calendar.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+namespace gtr {
+
+// Frames are written once this much is buffered
+constexpr size_t DATETIME_SERIES_BUFFER = 1 << 20;
+
+// FNV-1a over 64 bit words
+static unsigned long long series_checksum(unsigned long long hash, const void *data, size_t size) {
+    const char *bytes = static_cast<const char *>(data);
+    for (size_t i = 0; i + 8 <= size; i += 8) {
+        unsigned long long word = 0;
+        std::memcpy(&word, bytes + i, 8);
+        hash = (hash ^ word) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static unsigned long long series_footer_checksum(series_footer footer, const series_day *days, const series_minute *minutes) {
+    footer.checksum = 0;
+    unsigned long long hash = series_checksum(0xCBF29CE484222325ULL, &footer, sizeof(footer));
+    hash = series_checksum(hash, days, static_cast<size_t>(footer.day_count) * sizeof(series_day));
+    return series_checksum(hash, minutes, static_cast<size_t>(footer.minute_count) * sizeof(series_minute));
+}
+
+static long long series_footer_length(long long day_count, long long minute_count) {
+    return static_cast<long long>(sizeof(series_footer)) + day_count * static_cast<long long>(sizeof(series_day)) +
+           minute_count * static_cast<long long>(sizeof(series_minute));
+}
+
+// Rebuilds the index from the chain of footers ending at footer_offset, reading with read(offset, out, size).
+// last receives the footer of the last commit.
+template <class Read>
+static bool series_load_index(Read read, long long footer_offset, long long file_size, series_footer &last, std::vector<series_day> &days,
+                              std::vector<series_minute> &minutes) {
+    // Walked back from the last commit, each footer strictly before the one after it
+    std::vector<std::pair<long long, series_footer>> chain;
+    for (long long offset = footer_offset; offset != 0;) {
+        const long long payload = offset + static_cast<long long>(sizeof(series_frame));
+        series_frame frame{};
+        series_footer footer{};
+        if (offset < DATETIME_SERIES_HEADER_SIZE || offset % 8 != 0 || payload + static_cast<long long>(sizeof(footer)) > file_size ||
+            (!chain.empty() && offset >= chain.back().first) || !read(offset, &frame, sizeof(frame)) || !read(payload, &footer, sizeof(footer)))
+            return false;
+        if (frame.kind != series_frame_kind::footer || footer.magic != DATETIME_SERIES_MAGIC || footer.data_end != offset || footer.first_day < 0 ||
+            footer.day_count < 0 || footer.first_minute < 0 || footer.minute_count < 0 ||
+            series_footer_length(footer.day_count, footer.minute_count) != frame.length || payload + static_cast<long long>(frame.length) > file_size)
+            return false;
+        chain.emplace_back(offset, footer);
+        offset = footer.previous_footer;
+    }
+
+    days.clear();
+    minutes.clear();
+    for (auto link = chain.rbegin(); link != chain.rend(); ++link) {
+        const series_footer &footer = link->second;
+        if (footer.first_day > static_cast<long long>(days.size()) || footer.first_minute != static_cast<long long>(minutes.size()))
+            return false;
+        const long long payload = link->first + static_cast<long long>(sizeof(series_frame) + sizeof(series_footer));
+        const size_t first_day = static_cast<size_t>(footer.first_day);
+        days.resize(first_day + static_cast<size_t>(footer.day_count));
+        minutes.resize(minutes.size() + static_cast<size_t>(footer.minute_count));
+        series_day *new_days = days.data() + first_day;
+        series_minute *new_minutes = minutes.data() + footer.first_minute;
+        if (!read(payload, new_days, static_cast<size_t>(footer.day_count) * sizeof(series_day)) ||
+            !read(payload + footer.day_count * static_cast<long long>(sizeof(series_day)), new_minutes,
+                  static_cast<size_t>(footer.minute_count) * sizeof(series_minute)) ||
+            series_footer_checksum(footer, new_days, new_minutes) != footer.checksum)
+            return false;
+    }
+    // seek reads the minutes of a day without further checks
+    for (const series_day &day : days)
+        if (day.first_minute < 0 || day.minute_count < 0 || day.first_minute + day.minute_count > static_cast<long long>(minutes.size()))
+            return false;
+    last = chain.empty() ? series_footer{} : chain.front().second;
+    return true;
+}
+
+#ifdef __linux__
+static bool write_all(int fd, const char *data, size_t size, long long offset) {
+    while (size > 0) {
+        const ssize_t written = pwrite(fd, data, size, offset);
+        if (written <= 0)
+            return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += written;
+    }
+    return true;
+}
+
+static bool read_all(int fd, void *out, size_t size, long long offset) {
+    char *data = static_cast<char *>(out);
+    while (size > 0) {
+        const ssize_t read = pread(fd, data, size, offset);
+        if (read <= 0)
+            return false;
+        data += read;
+        size -= static_cast<size_t>(read);
+        offset += read;
+    }
+    return true;
+}
+#endif
+
+bool series_writer::open(const char *path) {
+#ifdef __linux__
+    close();
+    fd_ = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        return false;
+    const auto fail = [this] {
+        ::close(fd_);
+        fd_ = -1;
+        days_.clear();
+        minutes_.clear();
+        return false;
+    };
+    struct stat status;
+    if (fstat(fd_, &status) != 0)
+        return fail();
+    series_file_header header{};
+    if (status.st_size == 0) {
+        std::vector<char> page(DATETIME_SERIES_HEADER_SIZE, 0);
+        header.magic = DATETIME_SERIES_MAGIC;
+        std::memcpy(page.data(), &header, sizeof(header));
+        if (!write_all(fd_, page.data(), page.size(), 0) || fdatasync(fd_) != 0)
+            return fail();
+    } else if (!read_all(fd_, &header, sizeof(header), 0) || header.magic != DATETIME_SERIES_MAGIC) {
+        return fail();
+    }
+
+    end_ = DATETIME_SERIES_HEADER_SIZE;
+    footer_offset_ = static_cast<long long>(header.footer_offset);
+    if (footer_offset_ != 0) {
+        series_footer footer{};
+        const auto read = [this](long long offset, void *out, size_t size) { return read_all(fd_, out, size, offset); };
+        if (!series_load_index(read, footer_offset_, static_cast<long long>(status.st_size), footer, days_, minutes_))
+            return fail();
+        record_count_ = footer.record_count;
+        first_time_ = footer.first_time;
+        last_time_ = footer.last_time;
+        // Anything after the footer was never committed and is written over
+        end_ = footer_offset_ + series_frame_size(static_cast<unsigned int>(series_footer_length(footer.day_count, footer.minute_count)));
+    }
+    committed_days_ = days_.size();
+    committed_minutes_ = minutes_.size();
+    committed_day_minutes_ = days_.empty() ? 0 : days_.back().minute_count;
+    buffer_start_ = end_;
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void series_writer::close() {
+#ifdef __linux__
+    if (fd_ < 0)
+        return;
+    commit();
+    ::close(fd_);
+#endif
+    fd_ = -1;
+    buffer_.clear();
+    days_.clear();
+    minutes_.clear();
+    footer_offset_ = 0;
+    committed_days_ = 0;
+    committed_minutes_ = 0;
+    committed_day_minutes_ = 0;
+    record_count_ = 0;
+    dirty_ = false;
+}
+
+bool series_writer::append(datetime time, const void *data, unsigned int length) {
+    if (fd_ < 0 || (record_count_ > 0 && time.data < last_time_))
+        return false;
+    const long long offset = end_;
+    const long long day_begin = datetime_day_number(time.data) * DATETIME_MICROSECONDS_PER_DAY;
+    const bool new_day = days_.empty() || days_.back().day_begin != day_begin;
+    if (new_day)
+        days_.push_back({day_begin, offset, static_cast<long long>(minutes_.size()), 0});
+    const long long minute = (time.data - day_begin) / DATETIME_SERIES_MINUTE;
+    series_day &day = days_.back();
+    const bool new_minute = day.minute_count == 0 || minutes_.back().minute_of_day != minute;
+    if (new_minute) {
+        minutes_.push_back({minute, offset});
+        day.minute_count++;
+    }
+
+    const series_frame frame{time.data, length, series_frame_kind::record};
+    const size_t start = buffer_.size();
+    buffer_.resize(start + static_cast<size_t>(series_frame_size(length)), 0);
+    std::memcpy(buffer_.data() + start, &frame, sizeof(frame));
+    if (length > 0)
+        std::memcpy(buffer_.data() + start + sizeof(frame), data, length);
+    end_ += series_frame_size(length);
+
+    const long long previous_first = first_time_, previous_last = last_time_;
+    const bool previous_dirty = dirty_;
+    first_time_ = record_count_ == 0 ? time.data : first_time_;
+    last_time_ = time.data;
+    record_count_++;
+    dirty_ = true;
+    if (buffer_.size() < DATETIME_SERIES_BUFFER || flush())
+        return true;
+
+    // The record is taken back so a retry does not write it twice, the records before it stay buffered
+    buffer_.resize(start);
+    end_ = offset;
+    record_count_--;
+    first_time_ = previous_first;
+    last_time_ = previous_last;
+    dirty_ = previous_dirty;
+    if (new_minute) {
+        minutes_.pop_back();
+        days_.back().minute_count--;
+    }
+    if (new_day)
+        days_.pop_back();
+    return false;
+}
+
+bool series_writer::flush() {
+#ifdef __linux__
+    if (!write_all(fd_, buffer_.data(), buffer_.size(), buffer_start_))
+        return false;
+#endif
+    buffer_.clear();
+    buffer_start_ = end_;
+    return true;
+}
+
+bool series_writer::commit() {
+#ifdef __linux__
+    if (fd_ < 0 || !dirty_)
+        return fd_ >= 0;
+    // The last committed day is written again when it gained minutes, the days after it and the new minutes always
+    const size_t first_day =
+        committed_days_ > 0 && days_[committed_days_ - 1].minute_count != committed_day_minutes_ ? committed_days_ - 1 : committed_days_;
+    const series_day *days = days_.data() + first_day;
+    const series_minute *minutes = minutes_.data() + committed_minutes_;
+    series_footer footer{};
+    footer.magic = DATETIME_SERIES_MAGIC;
+    footer.data_end = end_;
+    footer.previous_footer = footer_offset_;
+    footer.record_count = record_count_;
+    footer.first_day = static_cast<long long>(first_day);
+    footer.day_count = static_cast<long long>(days_.size() - first_day);
+    footer.first_minute = static_cast<long long>(committed_minutes_);
+    footer.minute_count = static_cast<long long>(minutes_.size() - committed_minutes_);
+    footer.first_time = first_time_;
+    footer.last_time = last_time_;
+    footer.checksum = series_footer_checksum(footer, days, minutes);
+    const series_frame frame{0, static_cast<unsigned int>(series_footer_length(footer.day_count, footer.minute_count)),
+                             series_frame_kind::footer};
+
+    const long long footer_offset = end_;
+    const size_t start = buffer_.size();
+    buffer_.resize(start + static_cast<size_t>(series_frame_size(frame.length)), 0);
+    char *out = buffer_.data() + start;
+    std::memcpy(out, &frame, sizeof(frame));
+    std::memcpy(out + sizeof(frame), &footer, sizeof(footer));
+    std::memcpy(out + sizeof(frame) + sizeof(footer), days, static_cast<size_t>(footer.day_count) * sizeof(series_day));
+    std::memcpy(out + sizeof(frame) + sizeof(footer) + static_cast<size_t>(footer.day_count) * sizeof(series_day), minutes,
+                static_cast<size_t>(footer.minute_count) * sizeof(series_minute));
+    end_ += series_frame_size(frame.length);
+
+    // The records and the footer are durable before the header points at them, the 8 byte pointer is written at once
+    const unsigned long long pointer = static_cast<unsigned long long>(footer_offset);
+    const bool flushed = flush();
+    if (!flushed || fdatasync(fd_) != 0 || !write_all(fd_, reinterpret_cast<const char *>(&pointer), sizeof(pointer), 8) ||
+        fdatasync(fd_) != 0) {
+        // Only the footer is dropped, the next commit writes its own where this one failed
+        if (flushed)
+            buffer_start_ = footer_offset;
+        else
+            buffer_.resize(start);
+        end_ = footer_offset;
+        return false;
+    }
+    footer_offset_ = footer_offset;
+    committed_days_ = days_.size();
+    committed_minutes_ = minutes_.size();
+    committed_day_minutes_ = days_.empty() ? 0 : days_.back().minute_count;
+    dirty_ = false;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool series_reader::open(const char *path) {
+#ifdef __linux__
+    close();
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size < DATETIME_SERIES_HEADER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    void *memory = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+        return false;
+    base_ = static_cast<const char *>(memory);
+    mapped_ = status.st_size;
+
+    const series_file_header *header = reinterpret_cast<const series_file_header *>(base_);
+    if (header->magic != DATETIME_SERIES_MAGIC) {
+        close();
+        return false;
+    }
+    const long long footer_offset = static_cast<long long>(header->footer_offset);
+    if (footer_offset == 0)
+        return true;
+    series_footer footer{};
+    const auto read = [this](long long offset, void *out, size_t size) {
+        std::memcpy(out, base_ + offset, size);
+        return true;
+    };
+    if (!series_load_index(read, footer_offset, mapped_, footer, days_, minutes_)) {
+        close();
+        return false;
+    }
+    footer_ = reinterpret_cast<const series_footer *>(base_ + footer_offset + static_cast<long long>(sizeof(series_frame)));
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void series_reader::close() {
+#ifdef __linux__
+    if (base_ == nullptr)
+        return;
+    munmap(const_cast<char *>(base_), static_cast<size_t>(mapped_));
+#endif
+    base_ = nullptr;
+    mapped_ = 0;
+    footer_ = nullptr;
+    days_.clear();
+    minutes_.clear();
+}
+
+long long series_reader::seek(datetime time) const {
+    if (footer_ == nullptr)
+        return 0;
+    const long long day_begin = datetime_day_number(time.data) * DATETIME_MICROSECONDS_PER_DAY;
+    const series_day *days_end = days_.data() + days_.size();
+    const series_day *day = std::lower_bound(days_.data(), days_end, day_begin, [](const series_day &d, long long begin) { return d.day_begin < begin; });
+    if (day == days_end)
+        return footer_->data_end;
+    if (day->day_begin != day_begin)
+        return day->offset;
+    const long long minute = (time.data - day_begin) / DATETIME_SERIES_MINUTE;
+    const series_minute *first = minutes_.data() + day->first_minute;
+    const series_minute *last = first + day->minute_count;
+    const series_minute *found = std::lower_bound(first, last, minute, [](const series_minute &m, long long value) { return m.minute_of_day < value; });
+    if (found != last)
+        return found->offset;
+    return day + 1 != days_end ? (day + 1)->offset : footer_->data_end;
+}
+} // namespace gtr
@@ -0,0 +1,207 @@
+#ifndef DATETIME_SERIES_H
+#define DATETIME_SERIES_H
+#include "datetime.h"
+#include <vector>
+
+// An append-only file of timestamped records, indexed by day and by minute. Records are appended in time order and
+// made durable by commit, which writes an index footer after them and then points the header at it, so a crash
+// leaves the file at its last commit. Each footer holds the index entries added since the previous commit and the
+// offset of the previous footer; opening walks that chain once, then a range read touches the pages of the records
+// in range only. POSIX files on local disks, Linux only.
+//
+// Layout: a 4096 byte header, then frames aligned to 8 bytes. A frame is a series_frame followed by its payload,
+// either a record or a footer; footers of earlier commits stay between the records and are skipped.
+namespace gtr {
+
+constexpr unsigned long long DATETIME_SERIES_MAGIC = 0x3273656972657367ULL; // "gseries2"
+constexpr long long DATETIME_SERIES_HEADER_SIZE = 4096;
+constexpr long long DATETIME_SERIES_MINUTE = 60000000LL;
+
+struct series_file_header {
+    unsigned long long magic;
+    unsigned long long footer_offset; // the frame of the last committed footer, 0 before the first commit
+};
+
+enum class series_frame_kind : unsigned int { record = 0, footer = 1 };
+
+struct series_frame {
+    long long time;
+    unsigned int length; // of the payload, the frame takes 16 + length rounded up to 8 bytes
+    series_frame_kind kind;
+};
+
+/**
+ * @brief A day of records, its minutes are minute_count entries from first_minute in the minute index.
+ */
+struct series_day {
+    long long day_begin;
+    long long offset; // the first record of the day
+    long long first_minute;
+    long long minute_count;
+};
+
+/**
+ * @brief The first record of a minute, only minutes holding records have an entry.
+ */
+struct series_minute {
+    long long minute_of_day;
+    long long offset;
+};
+
+/**
+ * @brief The index entries of one commit, followed by its day_count days and minute_count minutes.
+ *
+ * The days replace the index from first_day on, the last day of the previous commit is repeated when it gained
+ * minutes. The minutes are appended, first_minute is the number of minutes committed before.
+ */
+struct series_footer {
+    unsigned long long magic;
+    long long data_end;        // the end of the committed records, the footer frame itself
+    long long previous_footer; // the frame of the previous commit's footer, 0 for the first commit
+    long long record_count;    // the records of all commits
+    long long first_day;
+    long long day_count;
+    long long first_minute;
+    long long minute_count;
+    long long first_time;
+    long long last_time;
+    unsigned long long checksum; // of the footer with checksum 0 and its days and minutes
+};
+
+inline constexpr long long series_frame_size(unsigned int length) {
+    return static_cast<long long>(sizeof(series_frame)) + ((static_cast<long long>(length) + 7) & ~7LL);
+}
+
+/**
+ * Appends records to a series file, from one thread and one process at a time.
+ */
+class series_writer {
+  public:
+    series_writer() = default;
+    series_writer(const series_writer &) = delete;
+    series_writer &operator=(const series_writer &) = delete;
+    ~series_writer() { close(); }
+
+    /**
+     * @brief Creates the file, or opens it to append after its last commit.
+     * @return False if the file cannot be opened or is not a valid series file.
+     */
+    bool open(const char *path);
+
+    /**
+     * @brief Commits and closes the file.
+     */
+    void close();
+
+    inline bool is_open() const { return fd_ >= 0; }
+
+    /**
+     * @brief Appends a record, visible to readers after the next commit.
+     * @return False if time is earlier than the last record, or on a write error. The record is then not appended
+     * and may be retried.
+     */
+    bool append(datetime time, const void *data, unsigned int length);
+
+    /**
+     * @brief Writes the footer and points the header at it, each followed by fdatasync.
+     *
+     * The footer holds the index entries added since the previous commit, but each commit costs two fdatasync and
+     * makes opening the file read one more footer, so commit in batches rather than after every record.
+     * @return False on a write error, the file is then still at its previous commit.
+     */
+    bool commit();
+
+    inline long long size() const { return record_count_; }
+
+  private:
+    int fd_{-1};
+    long long end_{0};        // where the next frame goes, buffered frames included
+    long long buffer_start_{0};
+    std::vector<char> buffer_; // frames not yet written
+    std::vector<series_day> days_;
+    std::vector<series_minute> minutes_;
+    long long footer_offset_{0};         // the last committed footer
+    size_t committed_days_{0};           // the index as of the last commit
+    size_t committed_minutes_{0};
+    long long committed_day_minutes_{0}; // the minute count of the last committed day
+    long long record_count_{0};
+    long long first_time_{0};
+    long long last_time_{0};
+    bool dirty_{false};
+
+    bool flush();
+};
+
+/**
+ * Maps a series file read only and reads its records in place.
+ *
+ * Sees the file as of its last commit when opened, open again to see later commits. The index is gathered from the
+ * footers of all commits at open.
+ */
+class series_reader {
+  public:
+    series_reader() = default;
+    series_reader(const series_reader &) = delete;
+    series_reader &operator=(const series_reader &) = delete;
+    ~series_reader() { close(); }
+
+    /**
+     * @return False if the file cannot be mapped or its header or a footer is invalid.
+     */
+    bool open(const char *path);
+
+    void close();
+
+    inline bool is_open() const { return base_ != nullptr; }
+
+    inline long long size() const { return footer_ ? footer_->record_count : 0; }
+
+    inline datetime first() const { return footer_ ? footer_->first_time : DATETIME_INVALID; }
+
+    inline datetime last() const { return footer_ ? footer_->last_time : DATETIME_INVALID; }
+
+    inline long long day_count() const { return static_cast<long long>(days_.size()); }
+
+    inline const series_day *days() const { return days_.data(); }
+
+    /**
+     * @brief Calls visit(time, data, length) for each record in [from, to), in file order.
+     * @return The number of records visited.
+     */
+    template <class Visit> inline long long range(datetime from, datetime to, Visit visit) const {
+        if (footer_ == nullptr || from.data >= to.data)
+            return 0;
+        long long offset = seek(from);
+        long long visited = 0;
+        while (offset < footer_->data_end) {
+            const series_frame *frame = reinterpret_cast<const series_frame *>(base_ + offset);
+            // Record frames are not checksummed, a torn length stops the walk instead of leaving the records
+            if (offset + series_frame_size(frame->length) > footer_->data_end)
+                break;
+            if (frame->kind == series_frame_kind::record) {
+                if (frame->time >= to.data)
+                    break;
+                if (frame->time >= from.data) {
+                    visit(datetime(frame->time), base_ + offset + sizeof(series_frame), frame->length);
+                    visited++;
+                }
+            }
+            offset += series_frame_size(frame->length);
+        }
+        return visited;
+    }
+
+    /**
+     * @brief The offset of the first record of the minute of time, or of the first later minute.
+     */
+    long long seek(datetime time) const;
+
+  private:
+    const char *base_{nullptr};
+    long long mapped_{0};
+    const series_footer *footer_{nullptr}; // the last commit's, in place
+    std::vector<series_day> days_;
+    std::vector<series_minute> minutes_;
+};
+} // namespace gtr
+#endif
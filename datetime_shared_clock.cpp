@@ -0,0 +1,135 @@
+#include "datetime_shared_clock.h"
+#include "datetime_calendar.h"
+#include <chrono>
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+namespace gtr {
+
+// Copies at most capacity characters and terminates, false if source is longer
+static bool copy_name(char *dest, const char *source, int capacity) {
+    int length = 0;
+    while (source[length] != '\0') {
+        if (length == capacity)
+            return false;
+        dest[length] = source[length];
+        length++;
+    }
+    dest[length] = '\0';
+    return true;
+}
+
+bool shared_clock_publisher::open(const char *name, long long interval_us, const char *format, clock_mode source) {
+#ifdef __linux__
+    close();
+    if (!copy_name(name_, name, static_cast<int>(sizeof(name_)) - 1) || !copy_name(format_, format, static_cast<int>(sizeof(format_)) - 1) ||
+        datetime_format_capacity(format_) > DATETIME_SHARED_CLOCK_TEXT_CAPACITY)
+        return false;
+    const int fd = shm_open(name_, O_CREAT | O_RDWR, 0644);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, sizeof(shared_clock_page)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void *memory = mmap(nullptr, sizeof(shared_clock_page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+        return false;
+    page_ = static_cast<shared_clock_page *>(memory);
+    source_ = source;
+    // A publisher that died mid update leaves the sequence odd
+    page_->sequence.store(page_->sequence.load(std::memory_order_relaxed) & ~1U, std::memory_order_relaxed);
+    page_->interval.store(interval_us > 0 ? interval_us : 1, std::memory_order_relaxed);
+    publish();
+    // Readers accept the page once it holds a first update
+    page_->magic.store(DATETIME_SHARED_CLOCK_MAGIC, std::memory_order_release);
+
+    stop_.store(false, std::memory_order_relaxed);
+    const long long interval = page_->interval.load(std::memory_order_relaxed);
+    thread_ = std::thread([this, interval] {
+        auto next = std::chrono::steady_clock::now();
+        while (!stop_.load(std::memory_order_relaxed)) {
+            next += std::chrono::microseconds(interval);
+            std::this_thread::sleep_until(next);
+            publish();
+        }
+    });
+    return true;
+#else
+    (void)name;
+    (void)interval_us;
+    (void)format;
+    (void)source;
+    return false;
+#endif
+}
+
+void shared_clock_publisher::close(bool unlink) {
+#ifdef __linux__
+    if (page_ == nullptr)
+        return;
+    stop_.store(true, std::memory_order_relaxed);
+    if (thread_.joinable())
+        thread_.join();
+    munmap(page_, sizeof(shared_clock_page));
+    page_ = nullptr;
+    if (unlink)
+        shm_unlink(name_);
+#else
+    (void)unlink;
+#endif
+}
+
+void shared_clock_publisher::publish() {
+    if (page_ == nullptr)
+        return;
+    const datetime time = clock_now(source_);
+    char text[DATETIME_SHARED_CLOCK_TEXT_CAPACITY + 1];
+    const int length = time.format_to(text, format_);
+    unsigned long long words[DATETIME_SHARED_CLOCK_TEXT_WORDS]{};
+    for (int i = 0; i < length; i++) words[i / 8] |= static_cast<unsigned long long>(static_cast<unsigned char>(text[i])) << (8 * (i % 8));
+
+    const unsigned int sequence = page_->sequence.load(std::memory_order_relaxed);
+    page_->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    page_->day_begin.store(datetime_day_number(time.data) * DATETIME_MICROSECONDS_PER_DAY, std::memory_order_relaxed);
+    page_->text_length.store(length, std::memory_order_relaxed);
+    for (int i = 0; i < DATETIME_SHARED_CLOCK_TEXT_WORDS; i++) page_->text[i].store(words[i], std::memory_order_relaxed);
+    page_->time.store(time.data, std::memory_order_release);
+    page_->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool shared_clock_reader::open(const char *name) {
+#ifdef __linux__
+    close();
+    const int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return false;
+    void *memory = mmap(nullptr, sizeof(shared_clock_page), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED)
+        return false;
+    page_ = static_cast<const shared_clock_page *>(memory);
+    if (page_->magic.load(std::memory_order_acquire) != DATETIME_SHARED_CLOCK_MAGIC) {
+        close();
+        return false;
+    }
+    return true;
+#else
+    (void)name;
+    return false;
+#endif
+}
+
+void shared_clock_reader::close() {
+#ifdef __linux__
+    if (page_ == nullptr)
+        return;
+    munmap(const_cast<shared_clock_page *>(page_), sizeof(shared_clock_page));
+    page_ = nullptr;
+#endif
+}
+} // namespace gtr
@@ -0,0 +1,147 @@
+#ifndef DATETIME_SHARED_CLOCK_H
+#define DATETIME_SHARED_CLOCK_H
+#include "datetime.h"
+#include "datetime_clock.h"
+#include <atomic>
+#include <thread>
+
+// A clock published into a shared-memory page by one process, the publisher, and read by any number of processes
+// without syscalls. Every reader sees the same value, as fresh as the publisher's interval. POSIX shared memory, Linux only.
+namespace gtr {
+
+constexpr unsigned int DATETIME_SHARED_CLOCK_MAGIC = 0x67747263; // "gtrc"
+constexpr int DATETIME_SHARED_CLOCK_TEXT_WORDS = 8;
+constexpr int DATETIME_SHARED_CLOCK_TEXT_CAPACITY = DATETIME_SHARED_CLOCK_TEXT_WORDS * 8 - 1;
+
+/**
+ * @brief The layout of the shared page. Every field is a lock-free atomic so it can be read from another process.
+ *
+ * time is a single word, always consistent on its own. The other fields belong to the same update and are read
+ * under the sequence lock, which is odd while the publisher writes.
+ */
+struct shared_clock_page {
+    std::atomic<unsigned int> magic;    // DATETIME_SHARED_CLOCK_MAGIC once the page is initialized
+    std::atomic<unsigned int> sequence;
+    std::atomic<long long> time;
+    std::atomic<long long> day_begin;   // the start of the UTC day of time
+    std::atomic<long long> interval;    // microseconds between updates
+    std::atomic<int> text_length;
+    std::atomic<unsigned long long> text[DATETIME_SHARED_CLOCK_TEXT_WORDS]; // time formatted by the publisher
+};
+
+static_assert(std::atomic<long long>::is_always_lock_free && std::atomic<unsigned long long>::is_always_lock_free &&
+                  std::atomic<unsigned int>::is_always_lock_free && std::atomic<int>::is_always_lock_free,
+              "the shared clock needs address free atomics");
+
+/**
+ * @brief A consistent copy of one update of the page.
+ */
+struct shared_clock_snapshot {
+    datetime time;
+    datetime day_begin;
+    long long interval{0}; /**< Microseconds between updates, the maximum age of time while the publisher runs. */
+    datetime_string<DATETIME_SHARED_CLOCK_TEXT_CAPACITY> text;
+};
+
+static_assert(sizeof(shared_clock_snapshot::text.buffer) == DATETIME_SHARED_CLOCK_TEXT_WORDS * 8, "the text is copied as whole words");
+
+/**
+ * Writes the time into a shared page from a background thread every interval.
+ *
+ * Stands in for a per host daemon: one process publishes, the others open a shared_clock_reader with the same name.
+ */
+class shared_clock_publisher {
+  public:
+    shared_clock_publisher() = default;
+    shared_clock_publisher(const shared_clock_publisher &) = delete;
+    shared_clock_publisher &operator=(const shared_clock_publisher &) = delete;
+    ~shared_clock_publisher() { close(); }
+
+    /**
+     * @brief Creates (or reuses) the shared page and starts publishing.
+     * @param name The POSIX shared memory name, e.g. "/gtr_clock".
+     * @param interval_us Microseconds between updates.
+     * @param format The format of the published text, its capacity must fit DATETIME_SHARED_CLOCK_TEXT_CAPACITY.
+     * @param source The clock read by the publisher.
+     * @return False if the page cannot be created or the format is too long.
+     */
+    bool open(const char *name, long long interval_us = 1000, const char *format = DATETIME_DEFAULT_FORMAT,
+              clock_mode source = clock_mode::system);
+
+    /**
+     * @brief Stops publishing and unmaps the page.
+     * @param unlink Also removes the name, readers already mapped keep the last value.
+     */
+    void close(bool unlink = true);
+
+    inline bool is_open() const { return page_ != nullptr; }
+
+  private:
+    shared_clock_page *page_{nullptr};
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    char name_[64]{};
+    char format_[64]{};
+    clock_mode source_{clock_mode::system};
+
+    // Writes one update, from open and then only from the background thread, the single writer of the sequence lock
+    void publish();
+};
+
+/**
+ * @brief Maps a published page read only and reads it lock free.
+ */
+class shared_clock_reader {
+  public:
+    shared_clock_reader() = default;
+    shared_clock_reader(const shared_clock_reader &) = delete;
+    shared_clock_reader &operator=(const shared_clock_reader &) = delete;
+    ~shared_clock_reader() { close(); }
+
+    /**
+     * @brief Maps the page.
+     * @return False if no publisher created the name.
+     */
+    bool open(const char *name);
+
+    void close();
+
+    inline bool is_open() const { return page_ != nullptr; }
+
+    /**
+     * @brief The last published time, a single load.
+     */
+    inline datetime now() const { return page_->time.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Copies the time, day boundary and text of the same update.
+     */
+    inline void read(shared_clock_snapshot &snapshot) const {
+        unsigned long long words[DATETIME_SHARED_CLOCK_TEXT_WORDS];
+        for (;;) {
+            const unsigned int before = page_->sequence.load(std::memory_order_acquire);
+            snapshot.time = page_->time.load(std::memory_order_relaxed);
+            snapshot.day_begin = page_->day_begin.load(std::memory_order_relaxed);
+            snapshot.interval = page_->interval.load(std::memory_order_relaxed);
+            int length = page_->text_length.load(std::memory_order_relaxed);
+            for (int i = 0; i < DATETIME_SHARED_CLOCK_TEXT_WORDS; i++) words[i] = page_->text[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((before & 1) != 0 || page_->sequence.load(std::memory_order_relaxed) != before)
+                continue;
+            length = length < 0 ? 0 : length > DATETIME_SHARED_CLOCK_TEXT_CAPACITY ? DATETIME_SHARED_CLOCK_TEXT_CAPACITY : length;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            __builtin_memcpy(snapshot.text.buffer, words, sizeof(words));
+#else
+            for (int i = 0; i < length; i++) snapshot.text.buffer[i] = static_cast<char>(words[i / 8] >> (8 * (i % 8)));
+#endif
+            snapshot.text.buffer[length] = '\0';
+            snapshot.text.length = length;
+            return;
+        }
+    }
+
+  private:
+    const shared_clock_page *page_{nullptr};
+};
+} // namespace gtr
+#endif
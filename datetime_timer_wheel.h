@@ -0,0 +1,381 @@
+#ifndef DATETIME_TIMER_WHEEL_H
+#define DATETIME_TIMER_WHEEL_H
+#include "datetime.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// A hierarchical timing wheel for timers at absolute datetime deadlines. Time is counted in ticks of a chosen
+// resolution; level L holds the timers whose deadline first differs from the current tick in the 6 bit digit L of
+// the tick, one slot per digit value. Timers move down a level when the wheel reaches their slot, so insert and
+// cancel are O(1) and advancing skips empty slots through one occupancy word per level.
+namespace gtr {
+
+/**
+ * @brief Identifies a scheduled timer, 0 is never a valid id.
+ */
+using timer_id = unsigned long long;
+
+constexpr int DATETIME_TIMER_LEVELS = 8; // 48 bits of ticks, nine years at 1µs
+constexpr int DATETIME_TIMER_SLOTS = 64;
+constexpr int DATETIME_TIMER_POOL_CHUNK = 4096;
+
+/**
+ * Holds the bookkeeping of timers in chunks that are never freed, addressed by 32 bit indexes and recycled through
+ * a free list.
+ */
+struct timer_pool {
+    static constexpr unsigned int nil = 0xFFFFFFFFU;
+
+    struct node {
+        unsigned int generation; // advanced when the node is freed, so stale ids do not cancel its next timer
+        unsigned int list;       // the slot holding the timer, nil when free
+        unsigned int position;   // in the slot, the next free node when free
+    };
+
+    std::vector<std::unique_ptr<node[]>> chunks;
+    unsigned int free_head{nil};
+    unsigned int allocated{0};
+
+    inline node &operator[](unsigned int index) { return chunks[index / DATETIME_TIMER_POOL_CHUNK][index % DATETIME_TIMER_POOL_CHUNK]; }
+    inline const node &operator[](unsigned int index) const {
+        return chunks[index / DATETIME_TIMER_POOL_CHUNK][index % DATETIME_TIMER_POOL_CHUNK];
+    }
+
+    inline unsigned int allocate() {
+        if (free_head != nil) {
+            const unsigned int index = free_head;
+            free_head = (*this)[index].position;
+            return index;
+        }
+        if (allocated == chunks.size() * DATETIME_TIMER_POOL_CHUNK)
+            add_chunk();
+        return allocated++;
+    }
+
+    inline void release(unsigned int index) {
+        node &freed = (*this)[index];
+        freed.generation++;
+        freed.list = nil;
+        freed.position = free_head;
+        free_head = index;
+    }
+
+    /**
+     * @brief Allocates enough chunks for count timers up front.
+     */
+    inline void reserve(unsigned int count) {
+        while (chunks.size() * DATETIME_TIMER_POOL_CHUNK < count) add_chunk();
+    }
+
+    inline void add_chunk() {
+        chunks.emplace_back(new node[DATETIME_TIMER_POOL_CHUNK]);
+        for (int i = 0; i < DATETIME_TIMER_POOL_CHUNK; i++) chunks.back()[i].generation = 0;
+    }
+};
+
+/**
+ * A bounded lock-free queue of timers scheduled from other threads, any number of producers and one consumer.
+ *
+ * Each cell carries a sequence number telling producers and the consumer whose turn it is (Vyukov's bounded queue).
+ */
+class timer_queue {
+  public:
+    /**
+     * @param capacity Rounded up to a power of two.
+     */
+    explicit timer_queue(unsigned int capacity = 4096) {
+        capacity_ = 1;
+        while (capacity_ < capacity) capacity_ *= 2;
+        cells_.reset(new cell[capacity_]);
+        for (unsigned int i = 0; i < capacity_; i++) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Queues a timer, safe from any thread.
+     * @return False if the queue is full.
+     */
+    inline bool push(long long deadline, unsigned long long payload) {
+        unsigned long long position = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            cell &slot = cells_[position & (capacity_ - 1)];
+            const unsigned long long sequence = slot.sequence.load(std::memory_order_acquire);
+            const long long lag = static_cast<long long>(sequence - position);
+            if (lag == 0) {
+                if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.deadline = deadline;
+                    slot.payload = payload;
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                return false;
+            } else {
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Takes the oldest timer, only from the consumer thread.
+     */
+    inline bool pop(long long &deadline, unsigned long long &payload) {
+        cell &slot = cells_[head_ & (capacity_ - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != head_ + 1)
+            return false;
+        deadline = slot.deadline;
+        payload = slot.payload;
+        slot.sequence.store(head_ + capacity_, std::memory_order_release);
+        head_++;
+        return true;
+    }
+
+  private:
+    struct cell {
+        std::atomic<unsigned long long> sequence;
+        long long deadline;
+        unsigned long long payload;
+    };
+
+    std::unique_ptr<cell[]> cells_;
+    unsigned int capacity_{1};
+    alignas(64) std::atomic<unsigned long long> tail_{0};
+    alignas(64) unsigned long long head_{0};
+};
+
+/**
+ * Fires timers at absolute deadlines, owned by one thread; other threads schedule through schedule_remote.
+ *
+ * A timer fires in the first advance_to at or after its deadline, never before, and at most one tick after.
+ * Each slot is an array of deadlines and payloads, so moving a slot down a level or firing it reads memory in
+ * order; the pool only keeps where each timer is, for cancel. The arrays keep their capacity, once the wheel has
+ * held as many timers as it will, scheduling does not allocate.
+ */
+class timer_wheel {
+  public:
+    /**
+     * @param start The current time, deadlines before it fire on the next advance_to.
+     * @param tick_us The resolution in microseconds, 1 (1µs) to 1000000 (1s) typically.
+     * @param queue_capacity The capacity of the queue used by schedule_remote.
+     */
+    explicit timer_wheel(datetime start, long long tick_us = 1000, unsigned int queue_capacity = 4096)
+        : origin_(start.data), tick_(tick_us > 0 ? tick_us : 1), queue_(queue_capacity) {}
+
+    timer_wheel(const timer_wheel &) = delete;
+    timer_wheel &operator=(const timer_wheel &) = delete;
+
+    /**
+     * @brief Allocates the bookkeeping of count timers up front.
+     */
+    inline void reserve(unsigned int count) { pool_.reserve(count); }
+
+    /**
+     * @brief Schedules a timer from the owning thread.
+     * @param payload Handed back when the timer fires.
+     */
+    inline timer_id schedule(datetime deadline, unsigned long long payload) {
+        const unsigned int index = pool_.allocate();
+        place(entry{to_tick(deadline.data), payload, index});
+        size_++;
+        return (static_cast<unsigned long long>(pool_[index].generation) << 32) | (index + 1ULL);
+    }
+
+    /**
+     * @brief Schedules a timer from any thread, it is added by the next advance_to of the owner.
+     * @return False if the queue is full.
+     */
+    inline bool schedule_remote(datetime deadline, unsigned long long payload) { return queue_.push(deadline.data, payload); }
+
+    /**
+     * @brief Cancels a timer that has not fired.
+     * @return False if the timer already fired or was cancelled.
+     */
+    inline bool cancel(timer_id id) {
+        const unsigned int index = static_cast<unsigned int>(id) - 1U;
+        if (id == 0 || index >= pool_.allocated)
+            return false;
+        const timer_pool::node &timer = pool_[index];
+        if (timer.list == timer_pool::nil || timer.generation != static_cast<unsigned int>(id >> 32))
+            return false;
+        remove(timer.list, timer.position);
+        pool_.release(index);
+        size_--;
+        return true;
+    }
+
+    /**
+     * @brief Fires every timer due at time, calling fire(id, payload) for each.
+     *
+     * Timers scheduled by fire that are already due fire at the next tick this call reaches, or first thing on the next
+     * call when it reached time.
+     * @return The number of timers fired.
+     */
+    template <class Fire> inline long long advance_to(datetime time, Fire fire) {
+        long long deadline = 0;
+        unsigned long long payload = 0;
+        while (queue_.pop(deadline, payload)) schedule(deadline, payload);
+
+        const long long elapsed = time.data - origin_;
+        const unsigned long long target = elapsed < 0 ? 0 : static_cast<unsigned long long>(elapsed / tick_);
+        long long fired = fire_slot(fire);
+        while (now_ < target) {
+            const unsigned long long next = next_tick();
+            if (next > target) {
+                move_now(target);
+                break;
+            }
+            move_now(next);
+            cascade();
+            fired += fire_slot(fire);
+        }
+        return fired;
+    }
+
+    inline long long size() const { return size_; }
+
+    /**
+     * @brief The time the wheel has advanced to, rounded down to a tick.
+     */
+    inline datetime now() const { return origin_ + static_cast<long long>(now_) * tick_; }
+
+  private:
+    static constexpr int overflow_list = DATETIME_TIMER_LEVELS * DATETIME_TIMER_SLOTS;
+    static constexpr int firing_list = overflow_list + 1;
+    static constexpr int level_bits = 6;
+
+    struct entry {
+        unsigned long long tick;
+        unsigned long long payload;
+        unsigned int index; // in the pool
+    };
+
+    timer_pool pool_;
+    std::vector<entry> slots_[firing_list + 1];
+    unsigned long long occupied_[DATETIME_TIMER_LEVELS]{}; // a bit per non-empty slot
+    long long origin_;
+    long long tick_;
+    unsigned long long now_{0};
+    long long size_{0};
+    timer_queue queue_;
+
+    // Rounded up so a timer never fires before its deadline
+    inline unsigned long long to_tick(long long deadline) const {
+        const long long elapsed = deadline - origin_;
+        return elapsed <= 0 ? 0 : static_cast<unsigned long long>(elapsed / tick_ + (elapsed % tick_ != 0));
+    }
+
+    inline void push(unsigned int list, const entry &timer) {
+        std::vector<entry> &slot = slots_[list];
+        timer_pool::node &node = pool_[timer.index];
+        node.list = list;
+        node.position = static_cast<unsigned int>(slot.size());
+        slot.push_back(timer);
+        if (list < overflow_list)
+            occupied_[list / DATETIME_TIMER_SLOTS] |= 1ULL << (list % DATETIME_TIMER_SLOTS);
+    }
+
+    // Moves the last timer of the slot into the hole
+    inline void remove(unsigned int list, unsigned int position) {
+        std::vector<entry> &slot = slots_[list];
+        if (position + 1 != slot.size()) {
+            slot[position] = slot.back();
+            pool_[slot[position].index].position = position;
+        }
+        slot.pop_back();
+        if (list < overflow_list && slot.empty())
+            occupied_[list / DATETIME_TIMER_SLOTS] &= ~(1ULL << (list % DATETIME_TIMER_SLOTS));
+    }
+
+    // The level is the highest digit where the deadline differs from now, due timers go to the current slot
+    inline void place(const entry &timer) {
+        if (timer.tick <= now_) {
+            push(static_cast<unsigned int>(now_ % DATETIME_TIMER_SLOTS), timer);
+            return;
+        }
+        const int level = (63 - datetime_count_leading_zeros(timer.tick ^ now_)) / level_bits;
+        if (level >= DATETIME_TIMER_LEVELS) {
+            push(overflow_list, timer);
+            return;
+        }
+        push(static_cast<unsigned int>(level * DATETIME_TIMER_SLOTS + (timer.tick >> (level * level_bits)) % DATETIME_TIMER_SLOTS), timer);
+    }
+
+    // The first tick after now where a slot fires or cascades
+    inline unsigned long long next_tick() const {
+        unsigned long long next = ~0ULL;
+        for (int level = 0; level < DATETIME_TIMER_LEVELS; level++) {
+            const int shift = level * level_bits;
+            const int digit = static_cast<int>((now_ >> shift) % DATETIME_TIMER_SLOTS);
+            const unsigned long long later = digit == 63 ? 0 : occupied_[level] >> (digit + 1) << (digit + 1);
+            if (later == 0)
+                continue;
+            // The first tick of the slot, the digits above are those of now
+            const unsigned long long above = now_ >> (shift + level_bits) << (shift + level_bits);
+            const unsigned long long start = above + (static_cast<unsigned long long>(datetime_count_trailing_zeros(later)) << shift);
+            next = start < next ? start : next;
+        }
+        if (!slots_[overflow_list].empty()) {
+            const int shift = DATETIME_TIMER_LEVELS * level_bits;
+            const unsigned long long start = ((now_ >> shift) + 1) << shift;
+            next = start < next ? start : next;
+        }
+        return next;
+    }
+
+    // Moves now forward. The slot of now only holds timers that fire scheduled already due after it was fired, they
+    // move along to the slot of the new now.
+    inline void move_now(unsigned long long next) {
+        const unsigned int due = static_cast<unsigned int>(now_ % DATETIME_TIMER_SLOTS);
+        now_ = next;
+        if (!slots_[due].empty() && due != now_ % DATETIME_TIMER_SLOTS)
+            replace(due);
+    }
+
+    // Moves down the timers of the slots now has just reached, highest level first
+    inline void cascade() {
+        if (!slots_[overflow_list].empty() && now_ % (1ULL << (DATETIME_TIMER_LEVELS * level_bits)) == 0)
+            replace(overflow_list);
+        for (int level = DATETIME_TIMER_LEVELS - 1; level > 0; level--) {
+            const int shift = level * level_bits;
+            if (now_ % (1ULL << shift) != 0)
+                continue;
+            const unsigned int list = static_cast<unsigned int>(level * DATETIME_TIMER_SLOTS + (now_ >> shift) % DATETIME_TIMER_SLOTS);
+            if (!slots_[list].empty())
+                replace(list);
+        }
+    }
+
+    // The slot is emptied into the firing list first, as placing may append to the slot itself
+    inline void replace(unsigned int list) {
+        std::vector<entry> &moving = slots_[firing_list];
+        moving.swap(slots_[list]);
+        if (list < overflow_list)
+            occupied_[list / DATETIME_TIMER_SLOTS] &= ~(1ULL << (list % DATETIME_TIMER_SLOTS));
+        for (const entry &timer : moving) place(timer);
+        moving.clear();
+    }
+
+    // Fires the slot of now from the firing list, last first, so fire may cancel any timer, those firing included
+    template <class Fire> inline long long fire_slot(Fire &fire) {
+        const unsigned int slot = static_cast<unsigned int>(now_ % DATETIME_TIMER_SLOTS);
+        if (slots_[slot].empty())
+            return 0;
+        std::vector<entry> &firing = slots_[firing_list];
+        firing.swap(slots_[slot]);
+        occupied_[0] &= ~(1ULL << slot);
+        for (unsigned int position = 0; position < firing.size(); position++) pool_[firing[position].index].list = firing_list;
+        long long fired = 0;
+        while (!firing.empty()) {
+            const entry timer = firing.back();
+            firing.pop_back();
+            const timer_id id = (static_cast<unsigned long long>(pool_[timer.index].generation) << 32) | (timer.index + 1ULL);
+            pool_.release(timer.index);
+            size_--;
+            fired++;
+            fire(id, timer.payload);
+        }
+        return fired;
+    }
+};
+} // namespace gtr
+#endif
@@ -1,43 +1,86 @@
 #ifndef DATETIME_FUNCS_H
 #define DATETIME_FUNCS_H
 #include "datetime.h"
+#include "datetime_calendar.h"
 
+// Differences between two datetimes, each in constant time. Results are truncated towards zero and negative when dt2
+// is before dt1.
 namespace gtr {
-inline long long microseconds_in_between(gtr::datetime dt1, gtr::datetime dt2) {
+inline constexpr long long microseconds_in_between(gtr::datetime dt1, gtr::datetime dt2) {
     return dt2.data - dt1.data;
 }
 
-inline long long seconds_in_between(gtr::datetime dt1, gtr::datetime dt2) {
+inline constexpr long long seconds_in_between(gtr::datetime dt1, gtr::datetime dt2) {
     return microseconds_in_between(dt1, dt2) / 1000000LL;
 }
 
-inline long long minutes_in_between(gtr::datetime dt1, gtr::datetime dt2) {
-    return seconds_in_between(dt1, dt2) / 60LL;
+inline constexpr long long minutes_in_between(gtr::datetime dt1, gtr::datetime dt2) {
+    return microseconds_in_between(dt1, dt2) / 60000000LL;
 }
 
-inline long long hours_in_between(gtr::datetime dt1, gtr::datetime dt2) {
-    return minutes_in_between(dt1, dt2) / 60LL;
+inline constexpr long long hours_in_between(gtr::datetime dt1, gtr::datetime dt2) {
+    return microseconds_in_between(dt1, dt2) / 3600000000LL;
 }
 
-inline long long days_in_between(gtr::datetime dt1, gtr::datetime dt2) {
-    return hours_in_between(dt1, dt2) / 24LL;
+inline constexpr long long days_in_between(gtr::datetime dt1, gtr::datetime dt2) {
+    return microseconds_in_between(dt1, dt2) / DATETIME_MICROSECONDS_PER_DAY;
 }
 
-inline long long months_in_between(gtr::datetime dt1, gtr::datetime dt2) {
-    gtr::datetime_struct p1, p2;
-    dt1.to_pack(p1);
-    dt2.to_pack(p2);
-    int month_diff;
-    if (p1.year > p2.year)
-        month_diff = p1.month - p2.month;
-    else
-        month_diff = p2.month - p1.month;
+// Months since year 0 of the day number
+constexpr inline long long calendar_month_index(int days) {
+    int year = 0, month = 0, day = 0;
+    civil_from_days(days, year, month, day);
+    return year * 12LL + month - 1;
+}
 
-    return (p2.year - p1.year) * 12 + month_diff;
+/**
+ * @brief Returns the difference of the calendar months, ignoring the day: January 31st to February 1st is one month.
+ *
+ * Going back across a year boundary gives the negated forward difference, earlier versions took the month part the
+ * wrong way round there.
+ */
+inline constexpr long long months_in_between(gtr::datetime dt1, gtr::datetime dt2) {
+    return calendar_month_index(datetime_day_number(dt2.data)) - calendar_month_index(datetime_day_number(dt1.data));
 }
 
-inline long long years_in_between(gtr::datetime dt1, gtr::datetime dt2) {
+inline constexpr long long years_in_between(gtr::datetime dt1, gtr::datetime dt2) {
     return months_in_between(dt1, dt2) / 12;
 }
+
+// Applies a difference to the pairs (from[i], to[i])
+template <class Kernel> inline void in_between_bulk(const datetime *from, const datetime *to, long long *out, long long count, Kernel kernel) {
+    for (long long i = 0; i < count; i++) out[i] = kernel(from[i], to[i]);
+}
+
+inline void seconds_in_between_bulk(const datetime *from, const datetime *to, long long *out, long long count) {
+    in_between_bulk(from, to, out, count, seconds_in_between);
+}
+
+inline void minutes_in_between_bulk(const datetime *from, const datetime *to, long long *out, long long count) {
+    in_between_bulk(from, to, out, count, minutes_in_between);
+}
+
+inline void hours_in_between_bulk(const datetime *from, const datetime *to, long long *out, long long count) {
+    in_between_bulk(from, to, out, count, hours_in_between);
+}
+
+inline void days_in_between_bulk(const datetime *from, const datetime *to, long long *out, long long count) {
+    in_between_bulk(from, to, out, count, days_in_between);
+}
+
+inline void months_in_between_bulk(const datetime *from, const datetime *to, long long *out, long long count) {
+    in_between_bulk(from, to, out, count, months_in_between);
+}
+
+inline void years_in_between_bulk(const datetime *from, const datetime *to, long long *out, long long count) {
+    in_between_bulk(from, to, out, count, years_in_between);
+}
+
+/**
+ * @brief Computes datetime::seconds_in_range for arrays of year ranges.
+ */
+inline void seconds_in_range_bulk(const int *start_years, const int *end_years, unsigned long long *out, long long count) {
+    for (long long i = 0; i < count; i++) out[i] = datetime::seconds_in_range(start_years[i], end_years[i]);
+}
 } // namespace gtr
 #endif